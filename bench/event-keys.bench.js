@@ -0,0 +1,52 @@
+'use strict';
+
+/* eslint-disable no-console */
+
+const aob = require('..');
+const Benchmark = require('benchmark');
+
+const serviceKey = `${process.env.AO_TOKEN_PROD}:node-bench-event-keys`;
+
+const status = aob.oboeInit({serviceKey});
+if (status > 0) {
+  throw new Error('failed to initialize oboe');
+}
+
+// wait 2 seconds to make sure it's ready.
+aob.isReadyToSample(2000);
+
+const keys = ['Layer', 'Label', 'Spec', 'RemoteURL', 'Query', 'Flavor', 'RemoteHost', 'Database'];
+const values = ['pg', 'entry', 'query', 'postgres://localhost:5432/db', 'SELECT 1', 'postgresql', 'localhost:5432', 'db'];
+const handles = keys.map(k => aob.Event.internKey(k));
+
+const parent = aob.Event.makeRandom(1);
+
+const suite = new Benchmark.Suite({name: 'event-keys'});
+
+suite
+  .add('string keys', function () {
+    const event = new aob.Event(parent);
+    for (let i = 0; i < keys.length; i++) {
+      event.addInfo(keys[i], values[i]);
+    }
+  })
+  .add('interned keys', function () {
+    const event = new aob.Event(parent);
+    for (let i = 0; i < handles.length; i++) {
+      event.addInfo(handles[i], values[i]);
+    }
+  })
+  .add('interned keys, addInfos', function () {
+    const event = new aob.Event(parent);
+    event.addInfos(handles, values);
+  })
+
+  .on('complete', function () {
+    console.log(this.name);
+    for (let i = 0; i < this.length; i++) {
+      const t = this[i];
+      console.log(t.name, t.stats.mean, t.count, t.times.elapsed);
+    }
+  })
+
+  .run();
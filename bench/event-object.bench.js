@@ -0,0 +1,52 @@
+'use strict';
+
+/* eslint-disable no-console */
+
+const aob = require('..');
+const Benchmark = require('benchmark');
+
+const serviceKey = `${process.env.AO_TOKEN_PROD}:node-bench-event-object`;
+
+const status = aob.oboeInit({serviceKey});
+if (status > 0) {
+  throw new Error('failed to initialize oboe');
+}
+
+// wait 2 seconds to make sure it's ready.
+aob.isReadyToSample(2000);
+
+const headers = {
+  host: 'localhost:3000',
+  'user-agent': 'Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36',
+  accept: 'text/html,application/xhtml+xml,application/xml;q=0.9',
+  'accept-encoding': 'gzip, deflate, br',
+  'content-length': 1024,
+  cookie: 'session=0123456789abcdef; theme=dark',
+};
+const query = {q: 'search terms', page: 2, filters: ['new', 'used'], exact: false};
+
+const parent = aob.Event.makeRandom(1);
+
+const suite = new Benchmark.Suite({name: 'event-object'});
+
+suite
+  .add('JSON.stringify', function () {
+    const event = new aob.Event(parent);
+    event.addInfo('Headers', JSON.stringify(headers));
+    event.addInfo('Query', JSON.stringify(query));
+  })
+  .add('native subdocument', function () {
+    const event = new aob.Event(parent);
+    event.addInfo('Headers', headers);
+    event.addInfo('Query', query);
+  })
+
+  .on('complete', function () {
+    console.log(this.name);
+    for (let i = 0; i < this.length; i++) {
+      const t = this[i];
+      console.log(t.name, t.stats.mean, t.count, t.times.elapsed);
+    }
+  })
+
+  .run();
@@ -0,0 +1,53 @@
+'use strict';
+
+/* eslint-disable no-console */
+
+const aob = require('..');
+const Benchmark = require('benchmark');
+
+const serviceKey = `${process.env.AO_TOKEN_PROD}:node-bench-event-send`;
+
+const status = aob.oboeInit({serviceKey});
+if (status > 0) {
+  throw new Error('failed to initialize oboe');
+}
+
+// wait 2 seconds to make sure it's ready.
+aob.isReadyToSample(2000);
+
+const parent = aob.Event.makeRandom(1);
+
+function send () {
+  const event = new aob.Event(parent);
+  event.addInfo('Layer', 'bench');
+  event.addInfo('Label', 'entry');
+  event.sendReport();
+}
+
+const suite = new Benchmark.Suite({name: 'event-send'});
+
+suite
+  .add('oboe timestamp and hostname', send, {
+    onStart () {
+      aob.Event.configure({cachedFinalize: false});
+    }
+  })
+  .add('cached timestamp and hostname', send, {
+    onStart () {
+      aob.Event.configure({cachedFinalize: true});
+    }
+  })
+
+  .on('complete', function () {
+    console.log(this.name);
+    for (let i = 0; i < this.length; i++) {
+      const t = this[i];
+      console.log(t.name, t.stats.mean, t.count, t.times.elapsed);
+    }
+    // the mean is seconds per send.
+    const [oboe, cached] = [this[0].stats.mean, this[1].stats.mean];
+    console.log(`oboe ${(oboe * 1e6).toFixed(3)}us/event, cached ${(cached * 1e6).toFixed(3)}us/event,`,
+      `${(oboe / cached).toFixed(2)}x`);
+  })
+
+  .run();
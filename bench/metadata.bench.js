@@ -14,17 +14,26 @@ if (status > 0) {
 }
 
 // wait 2 seconds to make sure it's ready.
-aob.Reporter.isReadyToSample(2000);
+aob.isReadyToSample(2000);
 
 const suite = new Benchmark.Suite({name: 'crypto'});
-let md1, md2, md3;
+const parent = aob.Event.makeRandom(1);
+let md1, md2, md3, md4;
 
 suite
   .add('oboe metadata', function () {
-    md1 = aob.Metadata.makeRandom();
+    md1 = aob.Event.makeRandom(1);
+  }, {
+    onStart () {
+      aob.Event.configure({pooledIds: false});
+    }
   })
-  .add('oboe metadata', function () {
-    md2 = aob.Metadata.makeRandom(1);
+  .add('pooled metadata', function () {
+    md2 = aob.Event.makeRandom(1);
+  }, {
+    onStart () {
+      aob.Event.configure({pooledIds: true});
+    }
   })
   .add('crypto metadata', function () {
     md3 = Buffer.allocUnsafe(30);
@@ -32,6 +41,22 @@ suite
     md3[29] = 0x00;
     crypto.randomFillSync(md3, 1, 28);
   })
+  .add('oboe op id (new Event)', function () {
+    md4 = new aob.Event(parent);
+    md4.dispose();
+  }, {
+    onStart () {
+      aob.Event.configure({pooledIds: false});
+    }
+  })
+  .add('pooled op id (new Event)', function () {
+    md4 = new aob.Event(parent);
+    md4.dispose();
+  }, {
+    onStart () {
+      aob.Event.configure({pooledIds: true});
+    }
+  })
 
   .on('complete', function () {
     console.log(this.name);
@@ -42,6 +67,7 @@ suite
     console.log(md1.toString(1));
     console.log(md2.toString(1));
     console.log(md3.toString('hex'));
+    console.log(md4.toString(1));
   })
 
   .run();
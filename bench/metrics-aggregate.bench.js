@@ -0,0 +1,88 @@
+'use strict';
+
+/* eslint-disable no-console */
+
+const aob = require('..');
+const Benchmark = require('benchmark');
+
+const serviceKey = `${process.env.AO_TOKEN_PROD}:node-bench-metrics-aggregate`;
+
+const status = aob.oboeInit({serviceKey});
+if (status > 0) {
+  throw new Error('failed to initialize oboe');
+}
+
+// wait 2 seconds to make sure it's ready.
+aob.isReadyToSample(2000);
+
+const routes = ['/', '/users', '/users/:id', '/orders', '/orders/:id'];
+let i = 0;
+
+function metrics () {
+  const route = routes[i++ % routes.length];
+  return [
+    {name: 'bench.requests', tags: {route, method: 'GET'}},
+    {name: 'bench.latency', value: i % 100, tags: {route, method: 'GET'}},
+  ];
+}
+
+const tagIds = routes.map(route => aob.Reporter.internTags({route, method: 'GET'}));
+
+function interned () {
+  const r = i++ % routes.length;
+  return [
+    {name: 'bench.requests', tags: tagIds[r]},
+    {name: 'bench.latency', value: i % 100, tags: tagIds[r]},
+  ];
+}
+
+const counters = routes.map(route => aob.Reporter.registerCounter('bench.requests', {route, method: 'GET'}));
+const summaries = routes.map(route => aob.Reporter.registerSummary('bench.latency', {route, method: 'GET'}));
+
+function registered () {
+  const r = i++ % routes.length;
+  Atomics.add(counters[r], 0, 1);
+  const summary = summaries[r];
+  summary[0] += 1;
+  summary[1] += i % 100;
+}
+
+const suite = new Benchmark.Suite({name: 'metrics-aggregate'});
+
+suite
+  .add('sendMetrics', function () {
+    aob.Reporter.sendMetrics(metrics());
+  })
+  .add('sendMetrics aggregated', function () {
+    aob.Reporter.sendMetrics(metrics(), {aggregate: true});
+  }, {
+    onComplete () {
+      aob.Reporter.flushAggregator();
+    }
+  })
+  .add('sendMetrics interned tags', function () {
+    aob.Reporter.sendMetrics(interned());
+  })
+  .add('sendMetrics interned tags aggregated', function () {
+    aob.Reporter.sendMetrics(interned(), {aggregate: true});
+  }, {
+    onComplete () {
+      aob.Reporter.flushAggregator();
+    }
+  })
+  .add('registered counter and summary', registered, {
+    onComplete () {
+      aob.Reporter.flushAggregator();
+    }
+  })
+
+  .on('complete', function () {
+    console.log(this.name);
+    for (let i = 0; i < this.length; i++) {
+      const t = this[i];
+      console.log(t.name, t.stats.mean, t.count, t.times.elapsed);
+    }
+    console.log(aob.Reporter.getAggregatorStats());
+  })
+
+  .run();
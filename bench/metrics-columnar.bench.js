@@ -0,0 +1,87 @@
+'use strict';
+
+/* eslint-disable no-console */
+
+const aob = require('..');
+const Benchmark = require('benchmark');
+
+const serviceKey = `${process.env.AO_TOKEN_PROD}:node-bench-metrics-columnar`;
+
+const status = aob.oboeInit({serviceKey});
+if (status > 0) {
+  throw new Error('failed to initialize oboe');
+}
+
+// wait 2 seconds to make sure it's ready.
+aob.isReadyToSample(2000);
+
+// a batch as a JavaScript aggregation layer would flush it.
+const batchSize = 100;
+const routes = ['/', '/users', '/users/:id', '/orders', '/orders/:id'];
+
+const requests = aob.Reporter.internName('bench.requests');
+const latency = aob.Reporter.internName('bench.latency');
+const tagIds = routes.map(route => aob.Reporter.internTags({route, method: 'GET'}));
+
+const columns = {
+  nameIds: new Uint32Array(batchSize),
+  counts: new Float64Array(batchSize),
+  values: new Float64Array(batchSize),
+  tagIds: new Uint32Array(batchSize),
+  flags: new Uint8Array(batchSize),
+};
+
+function objects () {
+  const metrics = [];
+  for (let i = 0; i < batchSize; i++) {
+    const tags = {route: routes[i % routes.length], method: 'GET'};
+    if (i & 1) {
+      metrics.push({name: 'bench.latency', count: 1, value: i, tags});
+    } else {
+      metrics.push({name: 'bench.requests', count: 3, tags});
+    }
+  }
+  aob.Reporter.sendMetrics(metrics);
+}
+
+function interned () {
+  const metrics = [];
+  for (let i = 0; i < batchSize; i++) {
+    const tags = tagIds[i % routes.length];
+    if (i & 1) {
+      metrics.push({name: 'bench.latency', count: 1, value: i, tags});
+    } else {
+      metrics.push({name: 'bench.requests', count: 3, tags});
+    }
+  }
+  aob.Reporter.sendMetrics(metrics);
+}
+
+function columnar () {
+  for (let i = 0; i < batchSize; i++) {
+    const summary = i & 1;
+    columns.nameIds[i] = summary ? latency : requests;
+    columns.counts[i] = summary ? 1 : 3;
+    columns.values[i] = i;
+    columns.tagIds[i] = tagIds[i % routes.length];
+    columns.flags[i] = summary ? aob.Reporter.COLUMNAR_SUMMARY : 0;
+  }
+  aob.Reporter.sendMetricsColumnar(columns);
+}
+
+const suite = new Benchmark.Suite({name: 'metrics-columnar'});
+
+suite
+  .add(`sendMetrics ${batchSize} objects`, objects)
+  .add(`sendMetrics ${batchSize} objects with interned tags`, interned)
+  .add(`sendMetricsColumnar ${batchSize} rows`, columnar)
+
+  .on('complete', function () {
+    console.log(this.name);
+    for (let i = 0; i < this.length; i++) {
+      const t = this[i];
+      console.log(t.name, t.stats.mean, t.count, t.times.elapsed);
+    }
+  })
+
+  .run();
@@ -27,9 +27,24 @@
         'src/settings.cc',
         'src/config.cc',
         'src/event.cc',
+        'src/event/event-data.cc',
         'src/event/event-to-string.cc',
         'src/event/event-send.cc',
+        'src/event/event-pool.cc',
+        'src/event/event-send-queue.cc',
+        'src/event/event-stamp.cc',
+        'src/event/event-to-bson.cc',
+        'src/event/event-deferred.cc',
+        'src/event/event-size.cc',
+        'src/event/event-histograms.cc',
+        'src/event/event-transfer.cc',
+        'src/event/event-ids.cc',
         'src/reporter.cc',
+        'src/reporter/reporter-aggregator.cc',
+        'src/reporter/reporter-handles.cc',
+        'src/reporter/reporter-histogram.cc',
+        'src/reporter/reporter-tags.cc',
+        'src/reporter/reporter-names.cc',
     ],
     'conditions': [
         ['OS in "linux"', {
@@ -1,34 +1,24 @@
 #ifndef NODE_OBOE_H_
 #define NODE_OBOE_H_
 
+#include <atomic>
 #include <iostream>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <napi.h>
 #include <oboe/oboe.h>
 
 typedef int (*send_generic_span_t) (char*, uint16_t, oboe_span_params_t*);
 
+struct EventData;
+struct hdr_histogram;
+
 //
 // Event - work with oboe's oboe_event_t structure.
 //
 class Event : public Napi::ObjectWrap<Event> {
-
-static size_t total_created;      // the total number created
-static size_t total_destroyed;    // destructor has been called
-static size_t ptotal_destroyed;   // previous total destructed
-static size_t total_bytes_alloc;  // total allocated active events
-static size_t bytes_freed;        // allocated bytes freed
-static size_t small_active;       // small not yet destructed
-static size_t full_active;        // full events not yet destructed
-static uint64_t lifetime;         // cumulative microsecs lifetime
-static uint64_t plifetime;        // previous total lifetime
-static uint64_t s_sendtime;       // cumulative microsecs time until sent
-static uint64_t s_psendtime;      // previous sendtime
-static size_t actual_bytes_used;  // total number of event bytes @ send (event + used bson buffer)
-static size_t sent_count;         // total number of events sent
-static size_t s_psent_count;      // previous count of events sent
-
 public:
   Event(const Napi::CallbackInfo& info);
   ~Event();
@@ -36,12 +26,24 @@ public:
 private:
   // C++ callable constructor.
   static Napi::Object NewInstance(Napi::Env);
+  static Napi::Object makeFromBytes(const Napi::Env env, const uint8_t* b);
 
+  // the state of the environment the event was created in.
+  EventData* data;
   // the oboe event this instance manages
   oboe_event_t event;
   // keep track of whether oboe_event_init() has been called. if so
   // then oboe_event_destroy() must be called to free the bson buffer.
   bool initialized;
+  // true once the event's buffer has been released by dispose() or moved
+  // out by detach(). the event can no longer be added to or sent.
+  bool disposed;
+  // true if KVs are recorded in deferred and encoded when needed.
+  bool lazy;
+  std::string deferred;
+  size_t deferred_bson_size;  // bytes the deferred KVs take in bson
+  // SizeEstimator class from the event's Layer or template; -1 if none yet.
+  int size_class;
 
   // stats
 
@@ -56,14 +58,35 @@ private:
  public:
   // methods that manipulate the instance's oboe_event_t
   Napi::Value addInfo(const Napi::CallbackInfo& info);
+  Napi::Value addInfoBatch(const Napi::CallbackInfo& info);
+  Napi::Value addInfos(const Napi::CallbackInfo& info);
   Napi::Value addEdge(const Napi::CallbackInfo& info);
   Napi::Value setSampleFlagTo(const Napi::CallbackInfo& info);
   Napi::Value getSampleFlag(const Napi::CallbackInfo& info);
 
   Napi::Value getBytesAllocated(const Napi::CallbackInfo& info);
+  Napi::Value dispose(const Napi::CallbackInfo& info);
+
+private:
+  // add a KV to the bson buffer; returns oboe's status or kInvalidValue.
+  static int add_kv(oboe_event_t* event, const char* key, const Napi::Value& value);
+  const static int kInvalidValue = -10000;
+  const static int kValueOutOfRange = -10001;
+  const static int kValueTooComplex = -10002;
+  // string values shorter than this are converted without a heap allocation.
+  const static size_t kValueBufferSize = 1024;
+  // keys shorter than this are converted without a heap allocation.
+  const static size_t kKeyBufferSize = 256;
+
+  // account for any change in the bson buffer's size since it was bb_size.
+  void track_bufsize(size_t bb_size, bool realloc = true);
+  void report_external(int64_t delta);
+
+public:
 
   // formatting the strings
   Napi::Value toString(const Napi::CallbackInfo& info);
+  Napi::Value writeTo(const Napi::CallbackInfo& info);
   const static int ff_header = 1;
   const static int ff_task = 2;
   const static int ff_op = 4;
@@ -83,14 +106,45 @@ private:
 
   Napi::Value sendStatus(const Napi::CallbackInfo& info);
   Napi::Value sendReport(const Napi::CallbackInfo& info);
+  static Napi::Value sendBatch(const Napi::CallbackInfo& info);
+
+  // sendReport() status when deferred KVs couldn't be encoded.
+  const static int kDeferredFailed = -1004;
 
 private:
-  int send_event_x(int channel);
+  int send_event_x(int channel, int64_t timestamp = 0);
+
+  // true if the event has a bson buffer that can be added to and sent.
+  bool writable() const {
+    return initialized && event.bbuf.buf != NULL;
+  }
+  // stop accounting for a bson buffer that's been handed off.
+  void forget_buffer();
+  // free the bson buffer or give it to the pool.
+  void release_buffer();
+  // release the buffer and mark the event spent; false if already done.
+  bool dispose_x();
+  // copy a template's KVs into the bson buffer; false if it can't be done.
+  bool apply_template_x(uint32_t handle);
+
+  // add a KV, deferring it if the event is lazy.
+  int add_kv_x(const char* key, const Napi::Value& value);
+  int defer_kv(const char* key, const Napi::Value& value);
+  const static int kNotDeferred = -10003;
+  // encode deferred KVs, reserving extra bytes; false on failure.
+  bool flush_deferred(size_t extra = 0);
+  void track_deferred(size_t capacity);
+  // room reserved for the timestamp and hostname when flushing for a send.
+  const static size_t kFinalizeReserve = 128;
+
+  // grow the bson buffer to the size predicted for the event's class.
+  void presize();
 
 public:
   // methods that create an invalid event that contains only metadata.
   static Napi::Value makeRandom(const Napi::CallbackInfo& info);
   static Napi::Value makeFromBuffer(const Napi::CallbackInfo& info);
+  static Napi::Value makeFromString(const Napi::CallbackInfo& info);
 
   // C++ instanceof equivalent
   static bool isEvent(Napi::Object);
@@ -98,15 +152,263 @@ public:
   // C++ method to create an unitialized, invalid oboe event.
   static Napi::Object makeFromOboeMetadata(const Napi::Env env, oboe_metadata_t& omd);
 
+  // metadata in its 30 byte binary form, without an Event.
+  static Napi::Value randomMetadata(const Napi::CallbackInfo& info);
+  static Napi::Value metadataFromString(const Napi::CallbackInfo& info);
+  static Napi::Value makeMetadataBuffer(const Napi::Env env, const oboe_metadata_t& omd);
+  // get metadata from a 30 byte Buffer or TypedArray; false if it isn't one.
+  static bool metadata_from_value(const Napi::Value& v, oboe_metadata_t* md);
+
+private:
+  static bool metadata_bytes_valid(const uint8_t* b);
+  static void metadata_from_bytes(const uint8_t* b, oboe_metadata_t* md);
+  static void metadata_to_bytes(const oboe_metadata_t* md, uint8_t* b);
+  static bool parse_xtrace(const Napi::Value& v, uint8_t* b);
+
+public:
+
   static Napi::Value getEventStats(const Napi::CallbackInfo& info);
 
- private:
-  static Napi::FunctionReference constructor;
+  // set options for events. some apply to the whole process and some only to
+  // the calling environment; configure()'s comment says which.
+  static Napi::Value configure(const Napi::CallbackInfo& info);
+
+  // get a handle that can be used in place of a key string.
+  static Napi::Value internKey(const Napi::CallbackInfo& info);
+  const static size_t kMaxInternedKeys = 4096;
+
+  // pre-encode KVs that are added to many events.
+  static Napi::Value createTemplate(const Napi::CallbackInfo& info);
+  Napi::Value applyTemplate(const Napi::CallbackInfo& info);
+  const static size_t kMaxTemplates = 1024;
+
+  // totals across the main thread and all worker_threads.
+  static Napi::Value getAggregateStats(const Napi::CallbackInfo& info);
+
+  // move an event to another environment without copying its bson buffer.
+  Napi::Value detach(const Napi::CallbackInfo& info);
+  static Napi::Value attach(const Napi::CallbackInfo& info);
 
 public:
   static Napi::Object Init(Napi::Env, Napi::Object);
 };
 
+//
+// EventPool recycles the bson buffers of destroyed events. each thread, so
+// each environment, has its own buffers, high-water mark and stats.
+//
+namespace EventPool {
+  const size_t kDefaultHighWaterMark = 256;
+  // size classes; the largest is 64 times the size oboe allocates.
+  const int kSizeClasses = 13;
+
+  struct stats_t {
+    size_t hits;          // events initialized from a pooled buffer
+    size_t misses;        // events that needed oboe_event_init()
+    size_t available;     // buffers currently in the pool
+    size_t shrunk;        // grown buffers shrunk to a class size when released
+    size_t exchanged;     // presized events given a pooled buffer of their class
+    int buffer_size;      // size of each pooled buffer (0 if not pooling)
+  };
+
+  void learn(const oboe_event_t*);
+  bool acquire(oboe_event_t*, const oboe_metadata_t*, const uint8_t* op_id);
+  bool release(oboe_event_t*);
+  size_t class_size(size_t bytes);
+  bool grow(oboe_event_t*, size_t size, bool* swapped);
+  void set_high_water_mark(size_t);
+  size_t get_high_water_mark();
+  stats_t get_stats();
+  void reset_stats();
+}
+
+//
+// SendQueue sends finished events from a native thread.
+//
+namespace SendQueue {
+  const size_t kDefaultCapacity = 4096;
+
+  struct stats_t {
+    bool running;
+    size_t capacity;          // items the ring holds
+    uint64_t depth;           // items waiting to be sent
+    uint64_t queued;          // items accepted
+    uint64_t sent;            // items passed to oboe_raw_send()
+    uint64_t drops;           // items the caller sent itself because the ring was full
+    uint64_t send_errors;     // oboe_raw_send() failures
+    double average_latency;   // microseconds from queued to sent
+    double max_latency;       // microseconds
+  };
+
+  bool start(napi_env, size_t capacity);
+  bool stop();
+  bool owned_by(napi_env);
+  bool running();
+  bool push(int channel, char* buf, size_t len);
+  stats_t get_stats();
+}
+
+//
+// SizeEstimator predicts the bson buffer size events need from the sizes of
+// earlier events with the same Layer or template.
+//
+namespace SizeEstimator {
+  const size_t kMaxClasses = 1024;
+
+  struct stats_t {
+    size_t presized;      // buffers grown to a prediction
+    size_t sent;          // events recorded
+    size_t wasted;        // total unused buffer bytes of recorded events
+  };
+
+  int for_layer(const std::string& layer);
+  int for_template(uint32_t handle);
+  size_t predict(int id);
+  void record(int id, size_t used, size_t allocated);
+  void count_presize();
+  stats_t get_stats();
+  void reset_stats();
+}
+
+//
+// Histograms keeps interval percentiles of event lifetimes, send times and
+// sizes for getEventStats().
+//
+namespace Histograms {
+  struct set_t {
+    struct hdr_histogram* lifetime;   // microseconds
+    struct hdr_histogram* sendtime;   // microseconds
+    struct hdr_histogram* size;       // bytes
+  };
+
+  set_t* create();
+  void destroy(set_t*);
+  void record_lifetime(set_t*, uint64_t us);
+  void record_sendtime(set_t*, uint64_t us);
+  void record_size(set_t*, size_t bytes);
+  void get_and_reset(set_t*, Napi::Object o);
+}
+
+//
+// EventData is the Event class's state for one environment. the main thread
+// and each worker_thread that loads the bindings has its own, kept as the
+// environment's instance data.
+//
+// the counters that make up the process-wide totals are written only by the
+// environment's thread but can be read by any thread, so they're relaxed
+// atomics that cost no more to update than plain integers.
+//
+struct EventData {
+  struct counter_t {
+    std::atomic<uint64_t> n;
+    counter_t() : n(0) {}
+    void add(uint64_t d) {
+      n.store(n.load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+    }
+    uint64_t get() const {
+      return n.load(std::memory_order_relaxed);
+    }
+  };
+
+  struct totals_t {
+    size_t environments;    // environments with the bindings loaded
+    uint64_t created;
+    uint64_t destroyed;
+    uint64_t sent;
+    uint64_t bytes_sent;
+  };
+
+  Napi::FunctionReference constructor;
+
+  // stats
+  counter_t total_created;      // the total number created
+  counter_t total_destroyed;    // destructor has been called
+  counter_t total_sent;         // like sent_count but never reset
+  counter_t total_bytes_sent;   // like actual_bytes_used but never reset
+  size_t ptotal_destroyed;      // previous total destructed
+  size_t total_bytes_alloc;     // total allocated active events
+  size_t bytes_freed;           // allocated bytes freed
+  size_t small_active;          // small not yet destructed
+  size_t full_active;           // full events not yet destructed
+  uint64_t lifetime;            // cumulative microsecs lifetime
+  uint64_t plifetime;           // previous total lifetime
+  uint64_t s_sendtime;          // cumulative microsecs time until sent
+  uint64_t s_psendtime;         // previous sendtime
+  size_t actual_bytes_used;     // total number of event bytes @ send (event + used bson buffer)
+  size_t sent_count;            // total number of events sent
+  size_t s_psent_count;         // previous count of events sent
+  size_t disposed_count;        // full events disposed before destruction
+  size_t finalized_count;       // full events whose buffer was freed by gc
+  size_t lazy_created;          // events created with deferred encoding
+  size_t realloc_count;         // times a bson buffer grew
+  Histograms::set_t* histograms;
+
+  // settings
+  bool auto_dispose;            // dispose events after they're sent
+  bool lazy_encoding;           // new events defer encoding their KVs
+  size_t send_queue_size;       // capacity used when the send queue starts
+
+  // interned keys and templates. a handle is an index into interned_keys or
+  // templates and is only valid in the environment that created it.
+  std::vector<std::string> interned_keys;
+  std::unordered_map<std::string, uint32_t> interned_handles;
+  std::vector<std::string> templates;
+
+  EventData();
+  ~EventData();
+
+  static EventData* create(Napi::Env env);
+  static EventData* get(napi_env env);
+  static totals_t get_totals();
+};
+
+//
+// ObjectEncoder appends plain objects and arrays to a bson buffer as
+// subdocuments.
+//
+namespace ObjectEncoder {
+  const int kMaxDepth = 16;
+  const size_t kMaxBytes = 64 * 1024;
+  // append() status when a limit is exceeded.
+  const int kLimitExceeded = -2;
+
+  int append(oboe_bson_buffer* b, const char* key, const Napi::Value& value);
+}
+
+//
+// Stamp appends the timestamp and hostname KVs from a coarse clock and a
+// cached copy of the hostname element. enabling it is process-wide.
+//
+namespace Stamp {
+  void set_enabled(bool enable);
+  bool is_enabled();
+  int64_t now_us();
+  bool timestamp(oboe_event_t*, int64_t us);
+  bool hostname(oboe_event_t*);
+}
+
+//
+// Transfer holds the lifetime of events detached for another environment.
+// the lifetime is process-wide.
+//
+namespace Transfer {
+  const uint64_t kDefaultLifetime = 60000;    // milliseconds
+
+  void set_lifetime(uint64_t ms);
+  uint64_t get_lifetime();
+}
+
+//
+// Ids generates random task and op IDs from a pooled CSPRNG buffer.
+// enabling it is process-wide.
+//
+namespace Ids {
+  bool op_id(uint8_t* dst);
+  bool random_metadata(oboe_metadata_t* md);
+  void set_enabled(bool enable);
+  bool is_enabled();
+}
+
 //
 // Settings is a collection of functions for getting/setting
 // oboe's tracing settings
@@ -115,6 +417,129 @@ namespace Settings {
   Napi::Object Init(Napi::Env, Napi::Object);
 }
 
+//
+// Aggregator combines custom metrics natively and sends them to oboe once
+// per interval.
+//
+namespace Aggregator {
+  const uint32_t kDefaultInterval = 60000;    // milliseconds
+  const size_t kMaxSeries = 10000;
+
+  // a name, tags and host tag flag and what's been recorded for them since
+  // the last flush.
+  struct series_t {
+    std::string name;
+    std::vector<std::string> keys;        // sorted
+    std::vector<std::string> values;
+    bool host_tag = false;
+    bool summary = false;
+    int64_t count = 0;
+    double sum = 0;
+    double min = 0;
+    double max = 0;
+  };
+
+  struct stats_t {
+    size_t series;            // series in the table
+    uint64_t recorded;        // metrics added to a series
+    uint64_t overflows;       // metrics sent directly because the table was full
+    uint64_t flushed;         // series sent to oboe
+    uint64_t send_errors;     // series oboe didn't accept
+  };
+
+  bool record(const std::string& name, const std::vector<std::string>& keys,
+              const std::vector<std::string>& values, bool host_tag, bool summary,
+              int64_t count, double value);
+  int send(const series_t&);
+  size_t flush(std::vector<series_t>* out, bool noop);
+  bool start(napi_env);
+  bool stop();
+  bool owned_by(napi_env);
+  bool running();
+  void set_interval(napi_env, uint32_t ms);
+  uint32_t get_interval();
+  stats_t get_stats();
+}
+
+//
+// TagSets interns custom metrics' tag sets as native oboe_metric_tag_t
+// arrays.
+//
+namespace TagSets {
+  const uint32_t kMaxTagSets = 16384;
+
+  struct tagset_t {
+    std::vector<std::string> keys;            // sorted
+    std::vector<std::string> values;
+    std::vector<oboe_metric_tag_t> otags;     // points into keys and values
+    std::string signature;
+  };
+
+  int64_t intern(std::vector<std::pair<std::string, std::string>> tags);
+  const tagset_t* get(uint32_t id);
+  const tagset_t* get(const Napi::Value& id);
+  Napi::Object to_object(Napi::Env, const tagset_t*);
+  Napi::Value internTags(const Napi::CallbackInfo& info);
+}
+
+//
+// MetricNames interns custom metric names for sendMetricsColumnar().
+//
+namespace MetricNames {
+  const uint32_t kMaxNames = 16384;
+
+  int64_t intern(const std::string& name);
+  const std::string* get(uint32_t id);
+  Napi::Value internName(const Napi::CallbackInfo& info);
+}
+
+//
+// Handles are counters and summaries that JavaScript updates in a
+// SharedArrayBuffer without calling the bindings.
+//
+class MetricHistogram;
+
+namespace Handles {
+  const size_t kMaxHandles = 4096;
+
+  size_t flush(std::vector<Aggregator::series_t>* out, bool noop);
+  void update_interval();
+  Napi::Value registerCounter(const Napi::CallbackInfo& info);
+  Napi::Value registerSummary(const Napi::CallbackInfo& info);
+  bool set_tags(const Napi::Value& tags, Aggregator::series_t* s);
+  // histograms are flushed with the handles of their environment.
+  bool add_histogram(napi_env, MetricHistogram*);
+  void remove_histogram(MetricHistogram*);
+}
+
+//
+// MetricHistogram records the distribution of a custom metric in an HDR
+// histogram and sends percentiles, min and max as summaries at each flush.
+//
+class MetricHistogram : public Napi::ObjectWrap<MetricHistogram> {
+public:
+  MetricHistogram(const Napi::CallbackInfo& info);
+  ~MetricHistogram();
+
+  static Napi::Function Define(Napi::Env);
+  // Reporter.createHistogram(); the constructor is the function's data.
+  static Napi::Value create(const Napi::CallbackInfo& info);
+
+  // send and reset; returns the number of summaries oboe didn't accept.
+  size_t flush(std::vector<Aggregator::series_t>* out, bool noop);
+
+  const static int kDefaultPrecision = 2;
+  // one hour in microseconds.
+  const static int64_t kDefaultMax = INT64_C(3600000000);
+
+private:
+  Napi::Value record(const Napi::CallbackInfo& info);
+
+  Aggregator::series_t series;        // name and tags of the summaries
+  std::vector<double> percentiles;
+  struct hdr_histogram* histogram;
+};
+
 //
 // Reporter is a collection of functions providing access to oboe's
 // send functions.
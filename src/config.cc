@@ -44,6 +44,19 @@ Napi::Value getStats(const Napi::CallbackInfo& info) {
     o.Set("collectorLimitExceeded", Napi::Number::New(env, stats->collector_response_limit_exceeded));
   }
 
+  // the bindings' async event send queue, which is shared by every
+  // environment in the process. latencies are microseconds for events sent
+  // since the previous call from any environment.
+  SendQueue::stats_t sq = SendQueue::get_stats();
+  o.Set("sendQueueRunning", Napi::Boolean::New(env, sq.running));
+  o.Set("sendQueueCapacity", Napi::Number::New(env, sq.capacity));
+  o.Set("sendQueueDepth", Napi::Number::New(env, sq.depth));
+  o.Set("sendQueueSent", Napi::Number::New(env, sq.sent));
+  o.Set("sendQueueDrops", Napi::Number::New(env, sq.drops));
+  o.Set("sendQueueErrors", Napi::Number::New(env, sq.send_errors));
+  o.Set("sendQueueLatency", Napi::Number::New(env, sq.average_latency));
+  o.Set("sendQueueMaxLatency", Napi::Number::New(env, sq.max_latency));
+
   return o;
 }
 
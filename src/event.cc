@@ -1,47 +1,61 @@
 #include "bindings.h"
 #include "uv.h"
+#include "event/hex.h"
 #include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
 
 #define MAX_SAFE_INTEGER (pow(2, 53) - 1)
 
-Napi::FunctionReference Event::constructor;
-
 Event::~Event() {
   // don't ask oboe to clean up unless the event was successfully created.
 
   if (initialized) {
-    full_active -= 1;
-    oboe_event_destroy(&event);
+    data->full_active -= 1;
+    // count only events whose buffer is freed here. there is no buffer if
+    // the event was disposed or the buffer was handed off when the event
+    // was sent.
+    if (this->event.bbuf.buf != NULL) {
+      data->finalized_count += 1;
+    }
+    release_buffer();
     // send time is only calculated for events that can be sent. it could be calculated in the send function
     // but doing it here keeps the logic together.
     if (send_time) {
-      s_sendtime += (send_time - creation_time + 500) / 1000;
+      data->s_sendtime += (send_time - creation_time + 500) / 1000;
     }
   } else {
-    small_active -= 1;
+    data->small_active -= 1;
   }
 
-  total_destroyed += 1;
+  data->total_destroyed.add(1);
 
   // get event lifetime in microseconds
   uint64_t now = uv_hrtime();
   uint64_t elifetime = (now - creation_time + 500) / 1000;
   // and accumulate it
-  lifetime += elifetime;
+  data->lifetime += elifetime;
+  Histograms::record_lifetime(data->histograms, elifetime);
 
   // now keep track of memory
-  bytes_freed += bytes_allocated;
-  total_bytes_alloc -= bytes_allocated;
+  data->bytes_freed += bytes_allocated;
+  data->total_bytes_alloc -= bytes_allocated;
+  report_external(-(int64_t)bytes_allocated);
 }
 
 //
 // JavaScript constructor
 //
 // new Event()
-// new Event(xtrace, addEdge = true)
+// new Event(xtrace, addEdge = true, template)
 //
-// @param {Metadata|Event|string} xtrace - X-Trace ID to use for creating event
+// @param {Event|Buffer} xtrace - X-Trace ID to use for creating event, an Event
+//   or 30 bytes of metadata from Event.randomMetadata() or
+//   Event.metadataFromString()
 // @param boolean [addEdge]
+// @param {number} [template] - a handle from Event.createTemplate() whose KVs
+//   are copied into the event
 //
 //
 // sizing
@@ -51,25 +65,35 @@ Event::~Event() {
 //
 Event::Event(const Napi::CallbackInfo& info) : Napi::ObjectWrap<Event>(info) {
     Napi::Env env = info.Env();
+    data = EventData::get(env);
 
-    total_created += 1;
+    data->total_created.add(1);
     bytes_allocated = sizeof(oboe_event_t);
-    total_bytes_alloc += bytes_allocated;
+    data->total_bytes_alloc += bytes_allocated;
+    report_external(bytes_allocated);
     creation_time = uv_hrtime();
     send_time = 0;
 
     oboe_metadata_t omd;
 
+    // metadata-only events never call oboe_event_init() so start with an
+    // empty event rather than whatever the memory held.
+    memset(&this->event, 0, sizeof(this->event));
+
     // keep track of whether oboe has initialized the event.
     initialized = false;
+    disposed = false;
+    lazy = false;
+    deferred_bson_size = 0;
+    size_class = -1;
 
     // no argument constructor just makes an empty event. used only by
     // Event::makeRandom() and Event::makeFromString().
     if (info.Length() == 0) {
-      small_active += 1;
+      data->small_active += 1;
       return;
     }
-    full_active += 1;
+    data->full_active += 1;
 
     // make sure there is metadata
     if (!info[0].IsObject()) {
@@ -79,14 +103,19 @@ Event::Event(const Napi::CallbackInfo& info) : Napi::ObjectWrap<Event>(info) {
 
     Napi::Object o = info[0].As<Napi::Object>();
 
-    if (!Event::isEvent(o)) {
+    if (info[0].IsTypedArray()) {
+      if (!metadata_from_value(info[0], &omd)) {
+        Napi::TypeError::New(env, "invalid metadata").ThrowAsJavaScriptException();
+        return;
+      }
+    } else if (Event::isEvent(o)) {
+      omd = Napi::ObjectWrap<Event>::Unwrap(o)->event.metadata;
+    } else {
       Napi::TypeError::New(env, "argument must be an Event")
           .ThrowAsJavaScriptException();
       return;
     }
 
-    omd = Napi::ObjectWrap<Event>::Unwrap(o)->event.metadata;
-
     // here there is metadata in omd and that's all the information needed in order
     // to create an event. add an edge if the caller requests.
     bool add_edge = false;
@@ -94,10 +123,18 @@ Event::Event(const Napi::CallbackInfo& info) : Napi::ObjectWrap<Event>(info) {
       add_edge = info[1].ToBoolean().Value();
     }
 
-    // supply the metadata for the event. oboe_event_init() will create a new
-    // random op ID for the event. (The op ID can be specified using the 3rd
-    // argument but there is no benefit to doing so here.)
-    int status = oboe_event_init(&this->event, &omd, NULL);
+    // supply the metadata for the event. a recycled buffer is used if the pool
+    // has one, otherwise oboe_event_init() allocates the bson buffer. the new
+    // op ID comes from the pooled ID generator; if that fails oboe makes one.
+    uint8_t op_id[OBOE_MAX_OP_ID_LEN];
+    const uint8_t* event_op_id = Ids::op_id(op_id) ? op_id : NULL;
+    int status = 0;
+    if (!EventPool::acquire(&this->event, &omd, event_op_id)) {
+      status = oboe_event_init(&this->event, &omd, event_op_id);
+      if (status == 0) {
+        EventPool::learn(&this->event);
+      }
+    }
     initialized = status == 0;
     if (!initialized) {
       Napi::Error::New(env, "oboe.event_init: " + std::to_string(status)).ThrowAsJavaScriptException();
@@ -105,7 +142,13 @@ Event::Event(const Napi::CallbackInfo& info) : Napi::ObjectWrap<Event>(info) {
     }
     size_t bb_size = this->event.bbuf.bufSize;
     bytes_allocated += bb_size;
-    total_bytes_alloc += bb_size;
+    data->total_bytes_alloc += bb_size;
+    report_external(bb_size);
+
+    lazy = data->lazy_encoding;
+    if (lazy) {
+      data->lazy_created += 1;
+    }
 
     if (add_edge) {
       int edge_status = oboe_event_add_edge(&this->event, &omd);
@@ -114,6 +157,14 @@ Event::Event(const Napi::CallbackInfo& info) : Napi::ObjectWrap<Event>(info) {
         return;
       }
     }
+
+    if (info.Length() >= 3 && !info[2].IsUndefined()) {
+      uint32_t handle;
+      if (napi_get_value_uint32(env, info[2], &handle) != napi_ok || !apply_template_x(handle)) {
+        Napi::RangeError::New(env, "Invalid template").ThrowAsJavaScriptException();
+        return;
+      }
+    }
 }
 
 //
@@ -123,7 +174,7 @@ Event::Event(const Napi::CallbackInfo& info) : Napi::ObjectWrap<Event>(info) {
 Napi::Object Event::NewInstance(const Napi::Env env) {
   Napi::EscapableHandleScope scope(env);
 
-  Napi::Object o = constructor.New({});
+  Napi::Object o = EventData::get(env)->constructor.New({});
 
   return scope.Escape(Napi::Value(o)).ToObject();
 }
@@ -139,8 +190,10 @@ Napi::Value Event::makeRandom(const Napi::CallbackInfo& info) {
   oboe_event_t* oe = &Napi::ObjectWrap<Event>::Unwrap(event)->event;
 
   // fill it with random data
-  oboe_metadata_init(&oe->metadata);
-  oboe_metadata_random(&oe->metadata);
+  if (!Ids::random_metadata(&oe->metadata)) {
+    oboe_metadata_init(&oe->metadata);
+    oboe_metadata_random(&oe->metadata);
+  }
 
   // set or clear the sample flag appropriately if an argument specified.
   if (info.Length() == 1) {
@@ -154,6 +207,84 @@ Napi::Value Event::makeRandom(const Napi::CallbackInfo& info) {
   return event;
 }
 
+//
+// the binary form of an X-Trace: header, task ID, op ID, flags.
+//
+static const size_t kXTraceBytes = 30;
+static const size_t kXTraceOpIdOffset = 1 + OBOE_MAX_TASK_ID_LEN;
+static const size_t kXTraceFlagsOffset = kXTraceOpIdOffset + OBOE_MAX_OP_ID_LEN;
+
+//
+// C++ function to check the binary form of an X-Trace: a version 2 header,
+// only the sample bit in flags, and a non-zero op ID.
+//
+bool Event::metadata_bytes_valid(const uint8_t* b) {
+  if (b[0] != 0x2b || b[kXTraceFlagsOffset] & 0xFE) {
+    return false;
+  }
+  uint8_t op = 0;
+  for (size_t i = kXTraceOpIdOffset; i < kXTraceFlagsOffset; i++) {
+    op |= b[i];
+  }
+  return op != 0;
+}
+
+//
+// C++ functions to convert between oboe metadata and the binary form of an
+// X-Trace.
+//
+void Event::metadata_from_bytes(const uint8_t* b, oboe_metadata_t* md) {
+  oboe_metadata_init(md);
+  memcpy(md->ids.task_id, b + 1, OBOE_MAX_TASK_ID_LEN);
+  memcpy(md->ids.op_id, b + kXTraceOpIdOffset, OBOE_MAX_OP_ID_LEN);
+  md->flags = b[kXTraceFlagsOffset];
+}
+
+void Event::metadata_to_bytes(const oboe_metadata_t* md, uint8_t* b) {
+  b[0] = 0x2b;
+  memcpy(b + 1, md->ids.task_id, OBOE_MAX_TASK_ID_LEN);
+  memcpy(b + kXTraceOpIdOffset, md->ids.op_id, OBOE_MAX_OP_ID_LEN);
+  b[kXTraceFlagsOffset] = md->flags;
+}
+
+//
+// C++ function to get metadata from a 30 byte Buffer or other TypedArray.
+// returns false if v isn't one or doesn't hold valid metadata.
+//
+bool Event::metadata_from_value(const Napi::Value& v, oboe_metadata_t* md) {
+  if (!v.IsTypedArray()) {
+    return false;
+  }
+  napi_typedarray_type type;
+  size_t length;
+  void* data;
+  napi_get_typedarray_info(v.Env(), v, &type, &length, &data, NULL, NULL);
+  if (length * v.As<Napi::TypedArray>().ElementSize() != kXTraceBytes) {
+    return false;
+  }
+  const uint8_t* b = static_cast<const uint8_t*>(data);
+  if (!metadata_bytes_valid(b)) {
+    return false;
+  }
+  metadata_from_bytes(b, md);
+  return true;
+}
+
+//
+// make a non-functional event from the binary form of an X-Trace.
+//
+Napi::Object Event::makeFromBytes(const Napi::Env env, const uint8_t* b) {
+  // make a JavaScript event and get the underlying C++ class.
+  Napi::Object event = Event::NewInstance(env);
+  oboe_event_t* oe = &Napi::ObjectWrap<Event>::Unwrap(event)->event;
+
+  // copy the bytes from the buffer to the oboe metadata portion
+  // of the event.
+  metadata_from_bytes(b, &oe->metadata);
+
+  return event;
+}
+
 //
 // Event factory for non-functional event with metadata from the supplied
 // buffer. This undocumented function requires that a valid xtrace id
@@ -168,33 +299,114 @@ Napi::Value Event::makeFromBuffer(const Napi::CallbackInfo& info) {
     return env.Undefined();
   }
   Napi::Buffer<uint8_t> b = info[0].As<Napi::Buffer<uint8_t>>();
-  if (b.Length() != 30) {
+  if (b.Length() != kXTraceBytes) {
     Napi::TypeError::New(env, "buffer must be length 30")
         .ThrowAsJavaScriptException();
     return env.Undefined();
   }
 
-  // make a JavaScript event and get the underlying C++ class.
-  Napi::Object event = Event::NewInstance(env);
-  oboe_event_t* oe = &Napi::ObjectWrap<Event>::Unwrap(event)->event;
+  return makeFromBytes(env, b.Data());
+}
 
-  const uint kHeaderBytes = 1;
-  const uint kTaskIdOffset = kHeaderBytes;
-  const uint kOpIdOffset = kTaskIdOffset + OBOE_MAX_TASK_ID_LEN;
-  const uint kFlagsOffset = kOpIdOffset + OBOE_MAX_OP_ID_LEN;
+//
+// Event factory for non-functional event with metadata from an X-Trace
+// string, e.g., an inbound X-Trace header.
+//
+// Event.makeFromString(string)
+//
+// @param {string} string - 60 hex digits, either case
+//
+// returns an Event or undefined if string isn't a valid X-Trace. nothing is
+// allocated for an invalid string.
+//
+Napi::Value Event::makeFromString(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
 
-  // copy the bytes from the buffer to the oboe metadata portion
-  // of the event.
-  oboe_metadata_init(&oe->metadata);
-  for (uint i = 0; i < OBOE_MAX_TASK_ID_LEN; i++) {
-    oe->metadata.ids.task_id[i] = b[kTaskIdOffset + i];
+  uint8_t b[kXTraceBytes];
+  if (info.Length() < 1 || !parse_xtrace(info[0], b)) {
+    return env.Undefined();
+  }
+
+  return makeFromBytes(env, b);
+}
+
+//
+// C++ function to decode an X-Trace string into its binary form. returns
+// false if v isn't a valid X-Trace string.
+//
+bool Event::parse_xtrace(const Napi::Value& v, uint8_t* b) {
+  napi_env env = v.Env();
+  const size_t kChars = kXTraceBytes * 2;
+
+  if (!v.IsString()) {
+    return false;
   }
-  for (uint i = 0; i < OBOE_MAX_OP_ID_LEN; i++) {
-    oe->metadata.ids.op_id[i] = b[kOpIdOffset + i];
+
+  // the length in UTF-16 code units is known without looking at the string.
+  // if it's right and the UTF-8 copy is all hex digits then every character
+  // is ASCII, so the copy is the whole string.
+  size_t len;
+  napi_status status = napi_get_value_string_utf16(env, v, NULL, 0, &len);
+  if (status != napi_ok || len != kChars) {
+    return false;
+  }
+  char chars[kChars + 1];
+  status = napi_get_value_string_utf8(env, v, chars, sizeof(chars), &len);
+  if (status != napi_ok || len != kChars) {
+    return false;
   }
-  oe->metadata.flags = b[kFlagsOffset];
 
-  return event;
+  return Hex::decode(chars, kXTraceBytes, b) && metadata_bytes_valid(b);
+}
+
+//
+// JavaScript callable functions that make metadata in its 30 byte binary
+// form without creating an Event. the Buffer can be used anywhere an Event
+// is accepted as metadata: new Event(), event.addEdge() and
+// Settings.getTraceSettings().
+//
+// Event.randomMetadata(sample)
+//
+// @param {boolean} [sample] - set or clear the sample flag
+//
+Napi::Value Event::randomMetadata(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  oboe_metadata_t omd;
+  if (!Ids::random_metadata(&omd)) {
+    oboe_metadata_init(&omd);
+    oboe_metadata_random(&omd);
+  }
+  omd.flags = info.Length() >= 1 && info[0].ToBoolean().Value() ? XTR_FLAGS_SAMPLED : 0;
+
+  return makeMetadataBuffer(env, omd);
+}
+
+//
+// Event.metadataFromString(string)
+//
+// @param {string} string - 60 hex digits, either case
+//
+// returns a Buffer or undefined if string isn't a valid X-Trace.
+//
+Napi::Value Event::metadataFromString(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  uint8_t b[kXTraceBytes];
+  if (info.Length() < 1 || !parse_xtrace(info[0], b)) {
+    return env.Undefined();
+  }
+
+  return Napi::Buffer<uint8_t>::Copy(env, b, kXTraceBytes);
+}
+
+//
+// C++ callable function to make the binary form of metadata.
+//
+Napi::Value Event::makeMetadataBuffer(const Napi::Env env, const oboe_metadata_t& omd) {
+  Napi::Buffer<uint8_t> b = Napi::Buffer<uint8_t>::New(env, kXTraceBytes);
+  metadata_to_bytes(&omd, b.Data());
+  return b;
 }
 
 //
@@ -224,26 +436,39 @@ Napi::Value Event::getSampleFlag(const Napi::CallbackInfo& info) {
 //
 // event.addEdge(edge)
 //
-// @param {Event | string} X-Trace ID to edge back to
+// @param {Event | Buffer | string} X-Trace ID to edge back to
 //
 Napi::Value Event::addEdge(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
 
     // Validate arguments. If init status is not 0 then this is a
     // non-functional, metadata-only event.
-    if (info.Length() != 1 || !initialized) {
+    if (info.Length() != 1 || !writable()) {
         Napi::TypeError::New(env, "invalid signature").ThrowAsJavaScriptException();
         return env.Undefined();
     }
 
+    // KVs deferred by lazy encoding were added before the edge so they're
+    // encoded first.
+    if (!flush_deferred()) {
+        Napi::Error::New(env, "Failed to add edge").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
     size_t bb_size = this->event.bbuf.bufSize;
 
     int status;
-    Napi::Object o = info[0].ToObject();
-    // is it an Event?
-    if (Event::isEvent(o)) {
-      Event* e = Napi::ObjectWrap<Event>::Unwrap(o);
+    oboe_metadata_t omd;
+    // is it an Event or metadata bytes?
+    if (info[0].IsObject() && Event::isEvent(info[0].As<Napi::Object>())) {
+      Event* e = Napi::ObjectWrap<Event>::Unwrap(info[0].As<Napi::Object>());
       status = oboe_event_add_edge(&this->event, &e->event.metadata);
+    } else if (info[0].IsTypedArray()) {
+      if (!metadata_from_value(info[0], &omd)) {
+        Napi::TypeError::New(env, "invalid edge").ThrowAsJavaScriptException();
+        return env.Undefined();
+      }
+      status = oboe_event_add_edge(&this->event, &omd);
     } else if (info[0].IsString()) {
         std::string str = info[0].As<Napi::String>();
         status = oboe_event_add_edge_fromstr(&this->event, str.c_str(), str.length());
@@ -253,11 +478,7 @@ Napi::Value Event::addEdge(const Napi::CallbackInfo& info) {
     }
 
     // adjust the bytes allocated in case the buffer size changed.
-    if ((unsigned)this->event.bbuf.bufSize != bb_size) {
-      size_t delta = this->event.bbuf.bufSize - bb_size;
-      bytes_allocated += delta;
-      total_bytes_alloc += delta;
-    }
+    track_bufsize(bb_size);
 
     if (status < 0) {
         Napi::Error::New(env, "Failed to add edge").ThrowAsJavaScriptException();
@@ -267,63 +488,256 @@ Napi::Value Event::addEdge(const Napi::CallbackInfo& info) {
     return Napi::Boolean::New(env, true);
 }
 
+//
+// get a string's nul-terminated utf8 bytes without a heap allocation when
+// they fit in buf; overflow holds longer strings.
+//
+// returns NULL if the value isn't a string.
+//
+static const char* get_utf8(napi_env env, napi_value v, char* buf, size_t size, std::string& overflow) {
+  size_t len;
+  if (napi_get_value_string_utf8(env, v, buf, size, &len) != napi_ok) {
+    return NULL;
+  }
+  // if it filled the buffer it might have been truncated.
+  if (len < size - 1) {
+    return buf;
+  }
+  overflow = Napi::String(env, v);
+  return overflow.c_str();
+}
+
+//
+// get a key's nul-terminated utf8 bytes. a key is either a string or a handle
+// returned by Event.internKey().
+//
+// returns NULL if the value isn't a string or a valid handle. a number must
+// be exactly a handle; napi_get_value_uint32() would truncate 1.5, -1 and
+// 2**32 + n to one.
+//
+static const char* get_key(napi_env env, napi_value v, char* buf, size_t size, std::string& overflow) {
+  double d;
+  if (napi_get_value_double(env, v, &d) == napi_ok) {
+    const EventData* data = EventData::get(env);
+    if (!(d >= 0 && d < data->interned_keys.size()) || d != static_cast<uint32_t>(d)) {
+      return NULL;
+    }
+    return data->interned_keys[static_cast<uint32_t>(d)].c_str();
+  }
+  return get_utf8(env, v, buf, size, overflow);
+}
+
+//
+// C++ method to add a single KV to an event's bson buffer. it does not
+// adjust bytes_allocated; the caller is expected to call track_bufsize()
+// after adding one or more KVs.
+//
+// Buffers and other TypedArrays are added from their backing store without
+// a copy. BigInts are added as 64 bit integers. other objects and arrays are
+// added as bson subdocuments.
+//
+// returns oboe's status, kInvalidValue if the value isn't a supported type,
+// kValueOutOfRange if a BigInt doesn't fit in 64 bits or kValueTooComplex if
+// an object exceeds ObjectEncoder's depth or size limit.
+//
+int Event::add_kv(oboe_event_t* event, const char* key, const Napi::Value& value) {
+  napi_env env = value.Env();
+
+  if (value.IsBoolean()) {
+    bool v = value.As<Napi::Boolean>().Value();
+    return oboe_event_add_info_bool(event, key, v);
+  } else if (value.IsNumber()) {
+    const double v = value.As<Napi::Number>();
+    double v_int;
+    // if it has a fractional part or is outside the range of integer values
+    // it's a double.
+    double v_frac = std::modf(v, &v_int);
+    if (v_frac != 0 || v > MAX_SAFE_INTEGER || v < -MAX_SAFE_INTEGER) {
+      return oboe_event_add_info_double(event, key, v);
+    }
+    return oboe_event_add_info_int64(event, key, v);
+  } else if (value.IsString()) {
+    char buf[kValueBufferSize];
+    std::string overflow;
+    const char* str = get_utf8(env, value, buf, sizeof(buf), overflow);
+    // binary is not really binary, it's utf8. but we don't want any embedded nulls so
+    // just use oboe_event_add_info.
+    return oboe_event_add_info(event, key, str);
+  } else if (value.IsTypedArray()) {
+    napi_typedarray_type type;
+    size_t length;
+    void* data;
+    if (napi_get_typedarray_info(env, value, &type, &length, &data, NULL, NULL) != napi_ok) {
+      return kInvalidValue;
+    }
+    size_t bytes = length * value.As<Napi::TypedArray>().ElementSize();
+    // an empty array can have a null data pointer.
+    return oboe_event_add_info_binary(event, key, data ? (const char*)data : "", bytes);
+  }
+#if NAPI_VERSION > 5
+  if (value.Type() == napi_bigint) {
+    int64_t v;
+    bool lossless;
+    if (napi_get_value_bigint_int64(env, value, &v, &lossless) != napi_ok) {
+      return kInvalidValue;
+    }
+    if (!lossless) {
+      return kValueOutOfRange;
+    }
+    return oboe_event_add_info_int64(event, key, v);
+  }
+#endif
+  // a function is an object but isn't a value that can be added.
+  if (value.IsObject() && !value.IsFunction()) {
+    int status = ObjectEncoder::append(&event->bbuf, key, value);
+    return status == ObjectEncoder::kLimitExceeded ? kValueTooComplex : status;
+  }
+
+  return kInvalidValue;
+}
+
+//
+// C++ method to adjust the bytes allocated in case the bson buffer's size
+// changed from bb_size. realloc is false if the buffer was swapped for a
+// pooled one rather than reallocated.
+//
+void Event::track_bufsize(size_t bb_size, bool realloc) {
+  if ((unsigned)this->event.bbuf.bufSize != bb_size) {
+    size_t delta = this->event.bbuf.bufSize - bb_size;
+    bytes_allocated += delta;
+    data->total_bytes_alloc += delta;
+    report_external((int64_t)this->event.bbuf.bufSize - (int64_t)bb_size);
+    if (realloc) {
+      data->realloc_count += 1;
+    }
+  }
+}
+
+//
+// C++ method to tell V8 about a change in the native memory held by the
+// event so that garbage collection is scheduled as if the memory were on
+// the JavaScript heap.
+//
+void Event::report_external(int64_t delta) {
+  Napi::MemoryManagement::AdjustExternalMemory(Env(), delta);
+}
+
+//
+// C++ method to give up the bson buffer after ownership has been passed
+// elsewhere. the event can no longer be added to or sent.
+//
+void Event::forget_buffer() {
+  size_t bb_size = this->event.bbuf.bufSize;
+
+  this->event.bbuf.buf = NULL;
+  this->event.bbuf.cur = NULL;
+  this->event.bbuf.bufSize = 0;
+  this->event.bbuf.finished = 0;
+  this->event.bb_str = NULL;
+
+  bytes_allocated -= bb_size;
+  data->total_bytes_alloc -= bb_size;
+  data->bytes_freed += bb_size;
+  report_external(-(int64_t)bb_size);
+}
+
+//
+// C++ method to free the bson buffer, or give it to the pool if the pool
+// will take it.
+//
+void Event::release_buffer() {
+  if (!deferred.empty()) {
+    const size_t capacity = deferred.capacity();
+    std::string().swap(deferred);
+    deferred_bson_size = 0;
+    track_deferred(capacity);
+  }
+  if (!this->event.bbuf.buf) {
+    return;
+  }
+  oboe_event_t released = this->event;
+  forget_buffer();
+  if (!EventPool::release(&released)) {
+    oboe_event_destroy(&released);
+  }
+}
+
+//
+// C++ method to release the bson buffer now instead of waiting for garbage
+// collection. the event's metadata remains valid.
+//
+// returns false if the event has no buffer to release or was already
+// disposed.
+//
+bool Event::dispose_x() {
+  if (!initialized || disposed) {
+    return false;
+  }
+  release_buffer();
+  disposed = true;
+  data->disposed_count += 1;
+  return true;
+}
+
+//
+// JavaScript method to free the event's bson buffer immediately. afterwards
+// the event can't be added to or sent; addInfo() throws and sendReport()
+// returns -2000.
+//
+// event.dispose()
+//
+// returns true if the event was disposed, false if it was already disposed
+// or never had a buffer (e.g., Event.makeRandom()).
+//
+Napi::Value Event::dispose(const Napi::CallbackInfo& info) {
+  return Napi::Boolean::New(info.Env(), dispose_x());
+}
+
 //
 // JavaScript method to add info to the event.
 //
 // event.addInfo(key, value)
 //
-// @param {string} key
-// @param {string | number | boolean} value
+// @param {string | number} key - a string or a handle from Event.internKey()
+// @param {string | number | boolean | bigint | Buffer | TypedArray | object | Array} value
 //
 Napi::Value Event::addInfo(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
 
     // Validate arguments
-    if (info.Length() != 2 || !info[0].IsString() || !initialized) {
+    if (info.Length() != 2 || !(info[0].IsString() || info[0].IsNumber()) || !writable()) {
         Napi::TypeError::New(env, "Invalid signature").ThrowAsJavaScriptException();
         return env.Undefined();
     }
 
-    oboe_event_t* event = &this->event;
+    size_t bb_size = this->event.bbuf.bufSize;
 
-    int status;
+    // Get key string, interned keys are used as is.
+    char buf[kKeyBufferSize];
+    std::string overflow;
+    const char* key = get_key(env, info[0], buf, sizeof(buf), overflow);
+    if (!key) {
+      Napi::RangeError::New(env, "Invalid key handle").ThrowAsJavaScriptException();
+      return env.Undefined();
+    }
 
-    size_t bb_size = this->event.bbuf.bufSize;
+    int status = add_kv_x(key, info[1]);
 
-    // Get key string
-    std::string key = info[0].As<Napi::String>();
-
-    if (info[1].IsBoolean()) {
-      bool v = info[1].As<Napi::Boolean>().Value();
-      status = oboe_event_add_info_bool(event, key.c_str(), v);
-    } else if (info[1].IsNumber()) {
-      const double v = info[1].As<Napi::Number>();
-      double v_int;
-      // if it has a fractional part or is outside the range of integer values
-      // it's a double.
-      double v_frac = std::modf(v, &v_int);
-      if (v_frac != 0 || v > MAX_SAFE_INTEGER || v < -MAX_SAFE_INTEGER) {
-        status = oboe_event_add_info_double(event, key.c_str(), v);
-      } else {
-        status = oboe_event_add_info_int64(event, key.c_str(), v);
-      }
-    } else if (info[1].IsString()) {
-      std::string str = info[1].As<Napi::String>();
-      // binary is not really binary, it's utf8. but we don't want any embedded nulls so
-      // just use oboe_event_add_info.
-      status = oboe_event_add_info(event, key.c_str(), str.c_str());
-    } else {
-      Napi::TypeError::New(env, "Value must be a boolean, string or number")
+    if (status == kInvalidValue) {
+      Napi::TypeError::New(env, "Value must be a boolean, string, number, bigint or object")
+          .ThrowAsJavaScriptException();
+      return env.Undefined();
+    } else if (status == kValueOutOfRange) {
+      Napi::RangeError::New(env, "BigInt value must fit in 64 bits")
+          .ThrowAsJavaScriptException();
+      return env.Undefined();
+    } else if (status == kValueTooComplex) {
+      Napi::RangeError::New(env, "Object value exceeds the depth or size limit")
           .ThrowAsJavaScriptException();
       return env.Undefined();
     }
 
-    // adjust the bytes allocated in case the buffer size changed.
-    if ((unsigned)this->event.bbuf.bufSize != bb_size) {
-      size_t delta = this->event.bbuf.bufSize - bb_size;
-      bytes_allocated += delta;
-      total_bytes_alloc += delta;
-    }
+    track_bufsize(bb_size);
 
     if (status < 0) {
       Napi::Error::New(env, "Failed to add info").ThrowAsJavaScriptException();
@@ -332,12 +746,265 @@ Napi::Value Event::addInfo(const Napi::CallbackInfo& info) {
     return Napi::Boolean::New(env, status == 0);
 }
 
+//
+// JavaScript method to add all the properties of an object to the event.
+//
+// event.addInfoBatch(kvs)
+//
+// @param {object} kvs - {key: value, ...} where each value is any type that
+//   addInfo() accepts.
+//
+// returns the number of KVs that could not be added. it does not throw for
+// KVs that fail.
+//
+Napi::Value Event::addInfoBatch(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() != 1 || !info[0].IsObject() || info[0].IsArray() || !writable()) {
+    Napi::TypeError::New(env, "Invalid signature").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  Napi::Object kvs = info[0].As<Napi::Object>();
+  Napi::Array keys = kvs.GetPropertyNames();
+
+  size_t bb_size = this->event.bbuf.bufSize;
+  uint32_t failures = 0;
+  char buf[kKeyBufferSize];
+  std::string overflow;
+
+  for (uint32_t i = 0; i < keys.Length(); i++) {
+    Napi::Value k = keys[i];
+    const char* key = get_key(env, k, buf, sizeof(buf), overflow);
+    if (!key || add_kv_x(key, kvs.Get(k)) != 0) {
+      failures += 1;
+    }
+  }
+
+  track_bufsize(bb_size);
+
+  return Napi::Number::New(env, failures);
+}
+
+//
+// JavaScript method to add KVs from parallel arrays of keys and values.
+//
+// event.addInfos(keys, values)
+//
+// @param {Array<string | number>} keys - strings or interned key handles
+// @param {Array} values - values[i] is the value for keys[i]; any type that
+//   addInfo() accepts.
+//
+// returns the number of KVs that could not be added. it does not throw for
+// KVs that fail.
+//
+Napi::Value Event::addInfos(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() != 2 || !info[0].IsArray() || !info[1].IsArray() || !writable()) {
+    Napi::TypeError::New(env, "Invalid signature").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  Napi::Array keys = info[0].As<Napi::Array>();
+  Napi::Array values = info[1].As<Napi::Array>();
+  if (keys.Length() != values.Length()) {
+    Napi::TypeError::New(env, "keys and values must be the same length")
+        .ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  size_t bb_size = this->event.bbuf.bufSize;
+  uint32_t failures = 0;
+  char buf[kKeyBufferSize];
+  std::string overflow;
+
+  for (uint32_t i = 0; i < keys.Length(); i++) {
+    Napi::Value k = keys[i];
+    const char* key = get_key(env, k, buf, sizeof(buf), overflow);
+    if (!key || add_kv_x(key, values[i]) != 0) {
+      failures += 1;
+    }
+  }
+
+  track_bufsize(bb_size);
+
+  return Napi::Number::New(env, failures);
+}
+
+//
+// JavaScript callable function to intern a key. the returned handle can be
+// used in place of the key string with addInfo() and addInfos(), skipping
+// the key's conversion on each call. interning the same name again returns
+// the same handle.
+//
+// Event.internKey(name)
+//
+// @param {string} name
+//
+// returns {number} handle
+//
+Napi::Value Event::internKey(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  EventData* data = EventData::get(env);
+
+  if (info.Length() != 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "key must be a string").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  std::string name = info[0].As<Napi::String>();
+
+  auto found = data->interned_handles.find(name);
+  if (found != data->interned_handles.end()) {
+    return Napi::Number::New(env, found->second);
+  }
+
+  if (data->interned_keys.size() >= kMaxInternedKeys) {
+    Napi::RangeError::New(env, "too many interned keys").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  uint32_t handle = data->interned_keys.size();
+  data->interned_keys.push_back(name);
+  data->interned_handles[name] = handle;
+
+  return Napi::Number::New(env, handle);
+}
+
+//
+// JavaScript callable function to create a template, the bson encoding of a
+// set of KVs that are added to many events. applying a template copies the
+// encoded KVs into an event instead of adding them one at a time.
+//
+// Event.createTemplate(kvs)
+//
+// @param {object} kvs - {key: value, ...} where each key is a string and each
+//   value is any type that addInfo() accepts.
+//
+// returns {number} template handle for new Event() or event.applyTemplate()
+//
+Napi::Value Event::createTemplate(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  EventData* data = EventData::get(env);
+
+  if (info.Length() != 1 || !info[0].IsObject() || info[0].IsArray()) {
+    Napi::TypeError::New(env, "kvs must be an object").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  if (data->templates.size() >= kMaxTemplates) {
+    Napi::RangeError::New(env, "too many templates").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  // encode the KVs into a scratch buffer and keep what follows the header.
+  oboe_event_t scratch;
+  memset(&scratch, 0, sizeof(scratch));
+  if (!oboe_bson_buffer_init(&scratch.bbuf)) {
+    Napi::Error::New(env, "Failed to create template").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  const size_t start = scratch.bbuf.cur - scratch.bbuf.buf;
+
+  Napi::Object kvs = info[0].As<Napi::Object>();
+  Napi::Array keys = kvs.GetPropertyNames();
+  const char* bad_key = NULL;
+  std::string key;
+
+  for (uint32_t i = 0; i < keys.Length() && !bad_key; i++) {
+    Napi::Value k = keys[i];
+    key = k.ToString().Utf8Value();
+    if (add_kv(&scratch, key.c_str(), kvs.Get(k)) != 0) {
+      bad_key = key.c_str();
+    }
+  }
+
+  if (bad_key) {
+    oboe_bson_buffer_destroy(&scratch.bbuf);
+    Napi::TypeError::New(env, std::string("Invalid template value for ") + bad_key).ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  uint32_t handle = data->templates.size();
+  data->templates.emplace_back(scratch.bbuf.buf + start, scratch.bbuf.cur - scratch.bbuf.buf - start);
+  oboe_bson_buffer_destroy(&scratch.bbuf);
+
+  return Napi::Number::New(env, handle);
+}
+
+//
+// C++ method to copy a template's encoded KVs into the event's bson buffer.
+//
+// returns false if the handle isn't valid or the event can't be added to.
+//
+bool Event::apply_template_x(uint32_t handle) {
+  if (handle >= data->templates.size() || !writable() || !flush_deferred()) {
+    return false;
+  }
+  if (size_class < 0) {
+    size_class = SizeEstimator::for_template(handle);
+    presize();
+  }
+
+  const std::string& t = data->templates[handle];
+  size_t bb_size = this->event.bbuf.bufSize;
+
+  if (!oboe_bson_ensure_space(&this->event.bbuf, t.length())) {
+    track_bufsize(bb_size);
+    return false;
+  }
+  memcpy(this->event.bbuf.cur, t.data(), t.length());
+  this->event.bbuf.cur += t.length();
+
+  track_bufsize(bb_size);
+  return true;
+}
+
+//
+// JavaScript method to add a template's KVs to the event.
+//
+// event.applyTemplate(template)
+//
+// @param {number} template - a handle from Event.createTemplate()
+//
+Napi::Value Event::applyTemplate(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() != 1 || !info[0].IsNumber() || !writable()) {
+    Napi::TypeError::New(env, "Invalid signature").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  if (!apply_template_x(info[0].As<Napi::Number>().Uint32Value())) {
+    Napi::RangeError::New(env, "Invalid template").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  return Napi::Boolean::New(env, true);
+}
+
 Napi::Value Event::getBytesAllocated(const Napi::CallbackInfo& info) {
   return Napi::Number::New(info.Env(), bytes_allocated);
 }
 
+//
+// JavaScript callable function to get event stats for the calling
+// environment.
+//
+// Event.getEventStats(flags)
+//
+// @param {number} [flags] - 1 resets the counters noted below
+//
+// every field covers only the calling environment. most come from its
+// EventData. the pool*, presizedCount and averageWasted fields come from
+// state kept per thread, which is the environment's own thread. events
+// queued for the process-wide async send queue count as sent by the
+// environment that queued them; the queue's own stats are in
+// Config.getStats(). Event.getAggregateStats() has totals for all
+// environments.
+//
 Napi::Value Event::getEventStats(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  EventData* data = EventData::get(env);
 
   int flags = 0;
 
@@ -347,123 +1014,270 @@ Napi::Value Event::getEventStats(const Napi::CallbackInfo& info) {
 
   Napi::Object o = Napi::Object::New(env);
   // this metric rises but cannot be reset
-  o.Set("totalCreated", Napi::Number::New(env, total_created));
+  o.Set("totalCreated", Napi::Number::New(env, data->total_created.get()));
 
   // these metrics rise and fall
-  o.Set("totalDestroyed", Napi::Number::New(env, total_destroyed));
-  o.Set("smallActive", Napi::Number::New(env, small_active));
-  o.Set("fullActive", Napi::Number::New(env, full_active));
-  o.Set("totalBytesAllocated", Napi::Number::New(env, total_bytes_alloc));
+  o.Set("totalDestroyed", Napi::Number::New(env, data->total_destroyed.get()));
+  o.Set("smallActive", Napi::Number::New(env, data->small_active));
+  o.Set("fullActive", Napi::Number::New(env, data->full_active));
+  o.Set("totalBytesAllocated", Napi::Number::New(env, data->total_bytes_alloc));
 
   // calculate some metrics on the fly
-  size_t events_active = total_created - total_destroyed;
+  size_t events_active = data->total_created.get() - data->total_destroyed.get();
   o.Set("totalActive", Napi::Number::New(env, events_active));
 
+  // full events released by dispose() vs. by garbage collection
+  o.Set("disposedCount", Napi::Number::New(env, data->disposed_count));
+  o.Set("finalizedCount", Napi::Number::New(env, data->finalized_count));
+
+  // deferred encoding and bson buffer growth
+  o.Set("lazyEncoding", Napi::Boolean::New(env, data->lazy_encoding));
+  o.Set("lazyCreated", Napi::Number::New(env, data->lazy_created));
+  o.Set("reallocCount", Napi::Number::New(env, data->realloc_count));
+
+  // buffers sized from earlier events and the unused bytes per sent event,
+  // from this thread's estimates.
+  SizeEstimator::stats_t sizing = SizeEstimator::get_stats();
+  o.Set("presizedCount", Napi::Number::New(env, sizing.presized));
+  double average_wasted = sizing.sent ? (double)sizing.wasted / sizing.sent : 0;
+  o.Set("averageWasted", Napi::Number::New(env, average_wasted));
+
   // these are only calculated when an event is destroyed so don't calculate
   // them unless some events have been destroyed.
-  size_t delta_destroyed = total_destroyed - ptotal_destroyed;
+  size_t delta_destroyed = data->total_destroyed.get() - data->ptotal_destroyed;
   double average_lifetime = 0;
   if (delta_destroyed != 0) {
-    average_lifetime = (lifetime - plifetime) / delta_destroyed;
-    ptotal_destroyed = total_destroyed;
+    average_lifetime = (data->lifetime - data->plifetime) / delta_destroyed;
+    data->ptotal_destroyed = data->total_destroyed.get();
   }
   o.Set("averageLifetime", Napi::Number::New(env, average_lifetime));
 
   double average_sendtime = 0;
-  size_t delta_sent = sent_count - s_psent_count;
+  size_t delta_sent = data->sent_count - data->s_psent_count;
   if (delta_sent != 0) {
-    average_sendtime = (s_sendtime - s_psendtime) / delta_sent;
+    average_sendtime = (data->s_sendtime - data->s_psendtime) / delta_sent;
   }
   o.Set("averageSendtime", Napi::Number::New(env, average_sendtime));
 
-  // these metrics only rise if not reset
-  o.Set("bytesUsed", Napi::Number::New(env, actual_bytes_used));
-  o.Set("sentCount", Napi::Number::New(env, sent_count));
-  o.Set("lifetime", Napi::Number::New(env, lifetime));
-  o.Set("sendtime", Napi::Number::New(env, s_sendtime));
-  o.Set("bytesFreed", Napi::Number::New(env, bytes_freed));
+  // percentiles of lifetime and create-to-send time (microseconds) and sent
+  // size (bytes) since the last call.
+  Histograms::get_and_reset(data->histograms, o);
 
-  // reset these if requested
+  // these metrics only rise if not reset
+  o.Set("bytesUsed", Napi::Number::New(env, data->actual_bytes_used));
+  o.Set("sentCount", Napi::Number::New(env, data->sent_count));
+  o.Set("lifetime", Napi::Number::New(env, data->lifetime));
+  o.Set("sendtime", Napi::Number::New(env, data->s_sendtime));
+  o.Set("bytesFreed", Napi::Number::New(env, data->bytes_freed));
+
+  // this thread's bson buffer pool
+  EventPool::stats_t pool = EventPool::get_stats();
+  o.Set("poolHits", Napi::Number::New(env, pool.hits));
+  o.Set("poolMisses", Napi::Number::New(env, pool.misses));
+  o.Set("poolAvailable", Napi::Number::New(env, pool.available));
+  o.Set("poolShrunk", Napi::Number::New(env, pool.shrunk));
+  o.Set("poolExchanged", Napi::Number::New(env, pool.exchanged));
+
+  // reset these if requested. the pool and sizing stats are reset for this
+  // thread only.
   if (flags & 0x01) {
-    actual_bytes_used = 0;
-    sent_count = 0;
-    lifetime = 0;
-    s_sendtime = 0;
-    bytes_freed = 0;
+    data->actual_bytes_used = 0;
+    data->sent_count = 0;
+    data->lifetime = 0;
+    data->s_sendtime = 0;
+    data->bytes_freed = 0;
+    data->realloc_count = 0;
+    EventPool::reset_stats();
+    SizeEstimator::reset_stats();
   }
 
   // and remember the previous values used for averages.
-  plifetime = lifetime;
-  s_psendtime = s_sendtime;
-  s_psent_count = sent_count;
+  data->plifetime = data->lifetime;
+  data->s_psendtime = data->s_sendtime;
+  data->s_psent_count = data->sent_count;
+
+  return o;
+}
+
+//
+// JavaScript callable function to get event totals across the main thread
+// and every worker_thread, including those that have exited. getEventStats()
+// only covers the calling thread's environment.
+//
+// Event.getAggregateStats()
+//
+Napi::Value Event::getAggregateStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  EventData::totals_t t = EventData::get_totals();
+
+  Napi::Object o = Napi::Object::New(env);
+  o.Set("environments", Napi::Number::New(env, t.environments));
+  o.Set("totalCreated", Napi::Number::New(env, t.created));
+  o.Set("totalDestroyed", Napi::Number::New(env, t.destroyed));
+  o.Set("totalActive", Napi::Number::New(env, t.created - t.destroyed));
+  o.Set("sentCount", Napi::Number::New(env, t.sent));
+  o.Set("bytesUsed", Napi::Number::New(env, t.bytes_sent));
 
   return o;
 }
 
+//
+// JavaScript callable function to set options for events.
+//
+// Event.configure(options)
+//
+// options have one of two scopes. "process" options change the behavior of
+// every environment, the main thread and all worker_threads. "environment"
+// options apply only to the environment that sets them; each worker_thread
+// starts with the defaults.
+//
+// @param {object} [options]
+// @param {number} [options.poolHighWaterMark] - environment. the maximum
+//   number of free bson buffers kept for reuse by new events. 0 disables
+//   pooling.
+// @param {boolean} [options.asyncSend] - process. if true sendReport() and
+//   sendStatus() queue the finished event for a native thread to send. if
+//   false the queue is drained and stopped and events are sent
+//   synchronously. there is one queue for the process; only the environment
+//   that started it stops it.
+// @param {number} [options.sendQueueSize] - environment. the number of events
+//   the async send queue holds if this environment starts it.
+// @param {boolean} [options.cachedFinalize] - process. if true (the default)
+//   the timestamp and hostname KVs are written from a coarse clock and a
+//   cached hostname element instead of by oboe for each event.
+// @param {boolean} [options.pooledIds] - process. if true (the default)
+//   random task and op IDs are taken from a pool refilled from the kernel in
+//   bulk instead of being generated by oboe one at a time.
+// @param {boolean} [options.autoDispose] - environment. if true events are
+//   disposed as soon as they're sent, as if event.dispose() were called.
+// @param {boolean} [options.lazyEncoding] - environment. if true events
+//   created from now on record KVs natively and encode them all at once when
+//   sent.
+// @param {number} [options.detachedLifetime] - process. milliseconds a handle
+//   from event.detach() can wait to be attached.
+//
+// returns the settings in effect after applying options.
+//
+Napi::Value Event::configure(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  EventData* data = EventData::get(env);
+
+  if (info.Length() > 0) {
+    if (!info[0].IsObject() || info[0].IsArray()) {
+      Napi::TypeError::New(env, "options must be an object").ThrowAsJavaScriptException();
+      return env.Undefined();
+    }
+    Napi::Object o = info[0].As<Napi::Object>();
+
+    Napi::Value v = o.Get("poolHighWaterMark");
+    if (v.IsNumber()) {
+      int64_t n = v.As<Napi::Number>().Int64Value();
+      EventPool::set_high_water_mark(n < 0 ? 0 : n);
+    }
+
+    v = o.Get("sendQueueSize");
+    if (v.IsNumber()) {
+      int64_t n = v.As<Napi::Number>().Int64Value();
+      data->send_queue_size = n < 1 ? 1 : n;
+    }
+
+    if (o.Has("asyncSend")) {
+      if (o.Get("asyncSend").ToBoolean().Value()) {
+        SendQueue::start(env, data->send_queue_size);
+      } else if (SendQueue::owned_by(env)) {
+        SendQueue::stop();
+      }
+    }
+
+    if (o.Has("cachedFinalize")) {
+      Stamp::set_enabled(o.Get("cachedFinalize").ToBoolean().Value());
+    }
+
+    if (o.Has("pooledIds")) {
+      Ids::set_enabled(o.Get("pooledIds").ToBoolean().Value());
+    }
+
+    if (o.Has("autoDispose")) {
+      data->auto_dispose = o.Get("autoDispose").ToBoolean().Value();
+    }
+
+    if (o.Has("lazyEncoding")) {
+      data->lazy_encoding = o.Get("lazyEncoding").ToBoolean().Value();
+    }
+
+    v = o.Get("detachedLifetime");
+    if (v.IsNumber()) {
+      int64_t n = v.As<Napi::Number>().Int64Value();
+      Transfer::set_lifetime(n < 0 ? 0 : n);
+    }
+  }
+
+  Napi::Object settings = Napi::Object::New(env);
+  settings.Set("poolHighWaterMark", Napi::Number::New(env, EventPool::get_high_water_mark()));
+  settings.Set("asyncSend", Napi::Boolean::New(env, SendQueue::running()));
+  settings.Set("sendQueueSize", Napi::Number::New(env, data->send_queue_size));
+  settings.Set("cachedFinalize", Napi::Boolean::New(env, Stamp::is_enabled()));
+  settings.Set("pooledIds", Napi::Boolean::New(env, Ids::is_enabled()));
+  settings.Set("autoDispose", Napi::Boolean::New(env, data->auto_dispose));
+  settings.Set("lazyEncoding", Napi::Boolean::New(env, data->lazy_encoding));
+  settings.Set("detachedLifetime", Napi::Number::New(env, Transfer::get_lifetime()));
+
+  return settings;
+}
+
 //
 // C++ callable method to determine if object is a JavaScript Event
 // instance.
 //
-inline bool Event::isEvent(Napi::Object o) {
-  return o.InstanceOf(constructor.Value());
+bool Event::isEvent(Napi::Object o) {
+  return o.InstanceOf(EventData::get(o.Env())->constructor.Value());
 }
 
-size_t Event::total_created;
-size_t Event::total_destroyed;
-size_t Event::ptotal_destroyed;
-size_t Event::bytes_freed;
-size_t Event::total_bytes_alloc;
-size_t Event::small_active;
-size_t Event::full_active;
-size_t Event::actual_bytes_used;
-size_t Event::sent_count;
-size_t Event::s_psent_count;
-size_t Event::lifetime;
-size_t Event::plifetime;
-size_t Event::s_sendtime;
-size_t Event::s_psendtime;
-
 //
 // initialize the module and expose the Event class.
 //
 Napi::Object Event::Init(Napi::Env env, Napi::Object exports) {
   Napi::HandleScope scope(env);
-  total_created = 0;
-  total_destroyed = 0;
-  ptotal_destroyed = 0;
-  bytes_freed = 0;
-  total_bytes_alloc = 0;
-  small_active = 0;
-  full_active = 0;
-  actual_bytes_used = 0;
-  sent_count = 0;
-  s_psent_count = 0;
-  lifetime = 0;
-  plifetime = 0;
-  s_sendtime = 0;
-  s_psendtime = 0;
+  EventData* data = EventData::create(env);
 
   Napi::Function ctor = DefineClass(
       env, "Event", {
         InstanceMethod("addInfo", &Event::addInfo),
+        InstanceMethod("addInfoBatch", &Event::addInfoBatch),
+        InstanceMethod("addInfos", &Event::addInfos),
         InstanceMethod("addEdge", &Event::addEdge),
         InstanceMethod("toString", &Event::toString),
+        InstanceMethod("writeTo", &Event::writeTo),
         InstanceMethod("getSampleFlag", &Event::getSampleFlag),
         InstanceMethod("sendReport", &Event::sendReport),
         InstanceMethod("sendStatus", &Event::sendStatus),
         InstanceMethod("getBytesAllocated", &Event::getBytesAllocated),
+        InstanceMethod("dispose", &Event::dispose),
+        InstanceMethod("applyTemplate", &Event::applyTemplate),
+        InstanceMethod("detach", &Event::detach),
 
         StaticValue("fmtHuman", Napi::Number::New(env, Event::fmtHuman)),
         StaticValue("fmtLog", Napi::Number::New(env, Event::fmtLog)),
+        StaticValue("SEND_EVENT", Napi::Number::New(env, OBOE_SEND_EVENT)),
+        StaticValue("SEND_STATUS", Napi::Number::New(env, OBOE_SEND_STATUS)),
 
         StaticMethod("makeRandom", &Event::makeRandom),
         StaticMethod("makeFromBuffer", &Event::makeFromBuffer),
+        StaticMethod("makeFromString", &Event::makeFromString),
+        StaticMethod("randomMetadata", &Event::randomMetadata),
+        StaticMethod("metadataFromString", &Event::metadataFromString),
         StaticMethod("getEventStats", &Event::getEventStats),
+        StaticMethod("configure", &Event::configure),
+        StaticMethod("internKey", &Event::internKey),
+        StaticMethod("createTemplate", &Event::createTemplate),
+        StaticMethod("sendBatch", &Event::sendBatch),
+        StaticMethod("getAggregateStats", &Event::getAggregateStats),
+        StaticMethod("attach", &Event::attach),
       }
     );
 
-  constructor = Napi::Persistent(ctor);
-  constructor.SuppressDestruct();
+  data->constructor = Napi::Persistent(ctor);
+  data->constructor.SuppressDestruct();
 
   exports.Set("Event", ctor);
 
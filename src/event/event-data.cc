@@ -0,0 +1,117 @@
+#include "bindings.h"
+#include <mutex>
+
+//
+// EventData holds the Event class's per-environment state so the bindings
+// can be loaded by worker_threads as well as the main thread.
+//
+// with N-API 6 and later the state is the environment's instance data and is
+// freed when the environment is torn down, after the environment's events
+// have been finalized. earlier versions have no instance data; each
+// environment runs on its own thread so the state is found through a
+// thread_local pointer and is not freed, so the totals count every
+// environment that has loaded the bindings as present.
+//
+// every EventData is registered so the process-wide totals can be summed.
+// the totals of environments that have gone away are kept in retired.
+//
+
+static std::mutex registry_lock;
+static std::vector<EventData*> registry;
+static EventData::totals_t retired = {0, 0, 0, 0, 0};
+
+#if NAPI_VERSION <= 5
+static thread_local EventData* current = NULL;
+#endif
+
+EventData::EventData() {
+  ptotal_destroyed = 0;
+  total_bytes_alloc = 0;
+  bytes_freed = 0;
+  small_active = 0;
+  full_active = 0;
+  lifetime = 0;
+  plifetime = 0;
+  s_sendtime = 0;
+  s_psendtime = 0;
+  actual_bytes_used = 0;
+  sent_count = 0;
+  s_psent_count = 0;
+  disposed_count = 0;
+  finalized_count = 0;
+  lazy_created = 0;
+  realloc_count = 0;
+  histograms = Histograms::create();
+
+  auto_dispose = false;
+  lazy_encoding = false;
+  send_queue_size = SendQueue::kDefaultCapacity;
+
+  std::lock_guard<std::mutex> lock(registry_lock);
+  registry.push_back(this);
+}
+
+EventData::~EventData() {
+  Histograms::destroy(histograms);
+
+  std::lock_guard<std::mutex> lock(registry_lock);
+  for (size_t i = 0; i < registry.size(); i++) {
+    if (registry[i] == this) {
+      registry[i] = registry.back();
+      registry.pop_back();
+      break;
+    }
+  }
+  retired.created += total_created.get();
+  retired.destroyed += total_destroyed.get();
+  retired.sent += total_sent.get();
+  retired.bytes_sent += total_bytes_sent.get();
+}
+
+#if NAPI_VERSION > 5
+static void finalize(napi_env env, void* data, void* hint) {
+  delete static_cast<EventData*>(data);
+}
+#endif
+
+//
+// create the state for env. called once, when the bindings are loaded.
+//
+EventData* EventData::create(Napi::Env env) {
+  EventData* data = new EventData;
+#if NAPI_VERSION > 5
+  napi_set_instance_data(env, data, finalize, NULL);
+#else
+  current = data;
+#endif
+  return data;
+}
+
+//
+// get the state for env.
+//
+EventData* EventData::get(napi_env env) {
+#if NAPI_VERSION > 5
+  void* data = NULL;
+  napi_get_instance_data(env, &data);
+  return static_cast<EventData*>(data);
+#else
+  return current;
+#endif
+}
+
+//
+// sum the totals of every environment, past and present.
+//
+EventData::totals_t EventData::get_totals() {
+  std::lock_guard<std::mutex> lock(registry_lock);
+  totals_t t = retired;
+  t.environments = registry.size();
+  for (const EventData* data : registry) {
+    t.created += data->total_created.get();
+    t.destroyed += data->total_destroyed.get();
+    t.sent += data->total_sent.get();
+    t.bytes_sent += data->total_bytes_sent.get();
+  }
+  return t;
+}
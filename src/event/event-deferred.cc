@@ -0,0 +1,235 @@
+#include "bindings.h"
+#include <cmath>
+#include <cstring>
+
+//
+// deferred (lazy) encoding. when Event.configure({lazyEncoding: true}) is in
+// effect new events don't encode KVs as they're added. each KV is appended
+// to a per-event slab as a tagged record and the exact bson size of all the
+// records is kept. when the event is sent, or something needs the KVs to be
+// in the bson buffer, the buffer is grown once to the exact size and the
+// records are encoded.
+//
+// a record is a tag byte, the nul-terminated key, then the value: one byte
+// for a boolean, 8 bytes for an integer or double, or a 4 byte length and the
+// bytes for a string (plus a nul) or binary data.
+//
+// objects and arrays can't be held without keeping a reference to them so
+// the pending records are encoded first and the object is encoded directly.
+//
+
+#define MAX_SAFE_INTEGER (pow(2, 53) - 1)
+
+enum {
+  kTagBool = 'b',
+  kTagLong = 'l',
+  kTagDouble = 'd',
+  kTagString = 's',
+  kTagBinary = 'x'
+};
+
+//
+// C++ method to add a KV, deferring its encoding if the event is lazy.
+//
+int Event::add_kv_x(const char* key, const Napi::Value& value) {
+  // the Layer determines which size estimate the event uses.
+  if (size_class < 0 && value.IsString() && strcmp(key, "Layer") == 0) {
+    size_class = SizeEstimator::for_layer(value.As<Napi::String>().Utf8Value());
+    presize();
+  }
+
+  if (lazy) {
+    int status = defer_kv(key, value);
+    if (status != kNotDeferred) {
+      return status;
+    }
+    // keep the KVs in the order they were added.
+    if (!flush_deferred()) {
+      return -1;
+    }
+  }
+  return add_kv(&this->event, key, value);
+}
+
+//
+// C++ method to record a KV in the event's slab.
+//
+// returns 0, kInvalidValue or kValueOutOfRange as add_kv() would, or
+// kNotDeferred if the value must be encoded directly.
+//
+int Event::defer_kv(const char* key, const Napi::Value& value) {
+  napi_env env = value.Env();
+  const size_t key_len = strlen(key);
+  const size_t capacity = deferred.capacity();
+  const size_t start = deferred.length();
+  // type byte, key, nul.
+  size_t bson_size = 1 + key_len + 1;
+
+  // the tag and key are written first; they are removed if the value isn't
+  // deferred.
+  deferred.push_back(0);
+  deferred.append(key, key_len + 1);
+
+  if (value.IsBoolean()) {
+    deferred[start] = kTagBool;
+    deferred.push_back(value.As<Napi::Boolean>().Value());
+    bson_size += 1;
+  } else if (value.IsNumber()) {
+    const double d = value.As<Napi::Number>();
+    double d_int;
+    if (std::modf(d, &d_int) != 0 || d > MAX_SAFE_INTEGER || d < -MAX_SAFE_INTEGER) {
+      deferred[start] = kTagDouble;
+      deferred.append((const char*)&d, sizeof(d));
+    } else {
+      deferred[start] = kTagLong;
+      int64_t l = d;
+      deferred.append((const char*)&l, sizeof(l));
+    }
+    bson_size += 8;
+  } else if (value.IsString()) {
+    deferred[start] = kTagString;
+    size_t len;
+    napi_get_value_string_utf8(env, value, NULL, 0, &len);
+    uint32_t len32 = len;
+    deferred.append((const char*)&len32, sizeof(len32));
+    const size_t offset = deferred.length();
+    deferred.resize(offset + len + 1);
+    napi_get_value_string_utf8(env, value, &deferred[offset], len + 1, &len);
+    bson_size += 4 + len + 1;
+  } else if (value.IsTypedArray()) {
+    napi_typedarray_type type;
+    size_t length;
+    void* data;
+    napi_get_typedarray_info(env, value, &type, &length, &data, NULL, NULL);
+    uint32_t len32 = length * value.As<Napi::TypedArray>().ElementSize();
+    deferred[start] = kTagBinary;
+    deferred.append((const char*)&len32, sizeof(len32));
+    deferred.append(data ? (const char*)data : "", len32);
+    // a length, a subtype or nul, and the bytes.
+    bson_size += 4 + 1 + len32;
+#if NAPI_VERSION > 5
+  } else if (value.Type() == napi_bigint) {
+    int64_t l;
+    bool lossless;
+    if (napi_get_value_bigint_int64(env, value, &l, &lossless) != napi_ok) {
+      deferred.resize(start);
+      return kInvalidValue;
+    }
+    if (!lossless) {
+      deferred.resize(start);
+      return kValueOutOfRange;
+    }
+    deferred[start] = kTagLong;
+    deferred.append((const char*)&l, sizeof(l));
+    bson_size += 8;
+#endif
+  } else {
+    deferred.resize(start);
+    return value.IsObject() ? kNotDeferred : kInvalidValue;
+  }
+
+  deferred_bson_size += bson_size;
+  track_deferred(capacity);
+  return 0;
+}
+
+//
+// C++ method to encode the deferred KVs into the bson buffer. extra is the
+// number of additional bytes to reserve.
+//
+// returns false if the buffer couldn't be grown or oboe failed to add a KV.
+//
+bool Event::flush_deferred(size_t extra) {
+  if (deferred.empty()) {
+    return true;
+  }
+
+  size_t bb_size = this->event.bbuf.bufSize;
+  bool ok = oboe_bson_ensure_space(&this->event.bbuf, deferred_bson_size + extra) != NULL;
+
+  const char* p = deferred.data();
+  const char* end = p + deferred.length();
+  while (ok && p < end) {
+    const char tag = *p++;
+    const char* key = p;
+    p += strlen(key) + 1;
+
+    int status;
+    if (tag == kTagBool) {
+      status = oboe_event_add_info_bool(&this->event, key, *p);
+      p += 1;
+    } else if (tag == kTagLong) {
+      int64_t l;
+      memcpy(&l, p, sizeof(l));
+      status = oboe_event_add_info_int64(&this->event, key, l);
+      p += sizeof(l);
+    } else if (tag == kTagDouble) {
+      double d;
+      memcpy(&d, p, sizeof(d));
+      status = oboe_event_add_info_double(&this->event, key, d);
+      p += sizeof(d);
+    } else {
+      uint32_t len;
+      memcpy(&len, p, sizeof(len));
+      p += sizeof(len);
+      if (tag == kTagString) {
+        status = oboe_event_add_info(&this->event, key, p);
+        p += len + 1;
+      } else {
+        status = oboe_event_add_info_binary(&this->event, key, p, len);
+        p += len;
+      }
+    }
+    ok = status == 0;
+  }
+
+  track_bufsize(bb_size);
+
+  // the slab isn't needed again.
+  const size_t capacity = deferred.capacity();
+  std::string().swap(deferred);
+  deferred_bson_size = 0;
+  track_deferred(capacity);
+
+  return ok;
+}
+
+//
+// C++ method to grow the bson buffer to the size predicted for the event's
+// size class so it doesn't grow repeatedly as KVs are added. lazy events
+// don't need it; they're sized exactly when encoded.
+//
+// the size is rounded up to the pool's size class so a pooled buffer can be
+// swapped in without a realloc(). if buffers aren't pooled, or the
+// prediction is larger than the largest class, the buffer is grown to
+// exactly the prediction.
+//
+void Event::presize() {
+  if (lazy || !writable()) {
+    return;
+  }
+  const size_t predicted = SizeEstimator::predict(size_class);
+  if (predicted <= (size_t)this->event.bbuf.bufSize) {
+    return;
+  }
+  size_t bb_size = this->event.bbuf.bufSize;
+  size_t size = EventPool::class_size(predicted);
+  bool swapped = false;
+  if (EventPool::grow(&this->event, size ? size : predicted, &swapped)) {
+    SizeEstimator::count_presize();
+  }
+  track_bufsize(bb_size, !swapped);
+}
+
+//
+// C++ method to account for a change in the slab's capacity since it was
+// capacity.
+//
+void Event::track_deferred(size_t capacity) {
+  if (deferred.capacity() != capacity) {
+    int64_t delta = (int64_t)deferred.capacity() - (int64_t)capacity;
+    bytes_allocated += delta;
+    data->total_bytes_alloc += delta;
+    report_external(delta);
+  }
+}
@@ -0,0 +1,96 @@
+#include "bindings.h"
+#include "metrics/hdr_histogram.h"
+
+//
+// Histograms records the distribution of event lifetimes, create-to-send
+// times and sizes so getEventStats() can report percentiles rather than
+// averages that hide the tail. like ao_metrics' eventloop histogram each is
+// reset when it's read, so the values cover the interval since the previous
+// getEventStats() call.
+//
+// two significant figures keep each histogram small enough that recording
+// stays cheap; percentiles are within 1%.
+//
+namespace Histograms {
+
+static const int kSignificantFigures = 2;
+// one hour in microseconds.
+static const int64_t kMaxMicroseconds = INT64_C(3600000000);
+// the largest event size recorded, 64MB.
+static const int64_t kMaxBytes = INT64_C(64) * 1024 * 1024;
+
+//
+// allocate a set of histograms. each environment has its own.
+//
+set_t* create() {
+  set_t* h = new set_t();
+  hdr_init(1, kMaxMicroseconds, kSignificantFigures, &h->lifetime);
+  hdr_init(1, kMaxMicroseconds, kSignificantFigures, &h->sendtime);
+  hdr_init(1, kMaxBytes, kSignificantFigures, &h->size);
+  return h;
+}
+
+void destroy(set_t* h) {
+  if (!h) {
+    return;
+  }
+  for (struct hdr_histogram* each : {h->lifetime, h->sendtime, h->size}) {
+    if (each) {
+      hdr_close(each);
+    }
+  }
+  delete h;
+}
+
+//
+// values out of range are clamped so they still count.
+//
+static inline void record(struct hdr_histogram* h, int64_t value) {
+  if (!h) {
+    return;
+  }
+  if (value > h->highest_trackable_value) {
+    value = h->highest_trackable_value;
+  } else if (value < 1) {
+    value = 1;
+  }
+  hdr_record_value(h, value);
+}
+
+void record_lifetime(set_t* h, uint64_t us) {
+  record(h->lifetime, us);
+}
+
+void record_sendtime(set_t* h, uint64_t us) {
+  record(h->sendtime, us);
+}
+
+void record_size(set_t* h, size_t bytes) {
+  record(h->size, bytes);
+}
+
+//
+// add p50, p90, p99 and max for a histogram to o as <name>P50, etc., and
+// reset the histogram. all are zero if nothing was recorded.
+//
+static void add(Napi::Object o, const std::string& name, struct hdr_histogram* h) {
+  Napi::Env env = o.Env();
+  const bool empty = !h || h->total_count == 0;
+
+  o.Set(name + "P50", Napi::Number::New(env, empty ? 0 : hdr_value_at_percentile(h, 50)));
+  o.Set(name + "P90", Napi::Number::New(env, empty ? 0 : hdr_value_at_percentile(h, 90)));
+  o.Set(name + "P99", Napi::Number::New(env, empty ? 0 : hdr_value_at_percentile(h, 99)));
+  o.Set(name + "Max", Napi::Number::New(env, empty ? 0 : hdr_max(h)));
+
+  if (!empty) {
+    hdr_reset(h);
+  }
+}
+
+void get_and_reset(set_t* h, Napi::Object o) {
+  add(o, "lifetime", h->lifetime);
+  add(o, "sendtime", h->sendtime);
+  add(o, "size", h->size);
+}
+
+} // end namespace Histograms
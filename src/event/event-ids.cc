@@ -0,0 +1,157 @@
+#include "bindings.h"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+//
+// Ids hands out random task and op IDs from a per-thread pool of bytes that
+// is refilled from the kernel's CSPRNG in bulk, so an ID costs a memcpy
+// instead of a system call or a trip through oboe_metadata_random().
+//
+// bytes are never handed out twice. a forked child discards the pool it
+// inherited so it can't generate the same IDs as its parent.
+//
+// if the kernel can't supply random bytes the functions return false and
+// the caller falls back to oboe.
+//
+namespace Ids {
+
+static const size_t kPoolSize = 8192;
+
+static std::atomic<bool> enabled(true);
+static std::atomic<uint64_t> fork_generation(0);
+static pthread_once_t atfork_once = PTHREAD_ONCE_INIT;
+
+struct pool_t {
+  uint8_t bytes[kPoolSize];
+  size_t pos = kPoolSize;           // next unused byte
+  uint64_t generation = 0;          // fork_generation when filled
+};
+
+static thread_local pool_t pool;
+
+static void after_fork_child() {
+  fork_generation += 1;
+}
+
+static void install_atfork() {
+  pthread_atfork(NULL, NULL, after_fork_child);
+}
+
+//
+// fill buf from /dev/urandom, for kernels without getrandom().
+//
+static bool read_urandom(uint8_t* buf, size_t n) {
+  int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  size_t got = 0;
+  while (got < n) {
+    ssize_t r = read(fd, buf + got, n - got);
+    if (r < 0 && errno == EINTR) {
+      continue;
+    }
+    if (r <= 0) {
+      break;
+    }
+    got += r;
+  }
+  close(fd);
+  return got == n;
+}
+
+static bool fill(uint8_t* buf, size_t n) {
+#if defined(__linux__) && defined(SYS_getrandom)
+  size_t got = 0;
+  while (got < n) {
+    long r = syscall(SYS_getrandom, buf + got, n - got, 0);
+    if (r < 0 && errno == EINTR) {
+      continue;
+    }
+    if (r < 0) {
+      return errno == ENOSYS && read_urandom(buf + got, n - got);
+    }
+    got += r;
+  }
+  return true;
+#else
+  return read_urandom(buf, n);
+#endif
+}
+
+//
+// take n random bytes from the pool, refilling it if needed.
+//
+static bool take(uint8_t* dst, size_t n) {
+  const uint64_t generation = fork_generation.load(std::memory_order_relaxed);
+  if (pool.pos + n > kPoolSize || pool.generation != generation) {
+    pthread_once(&atfork_once, install_atfork);
+    if (!fill(pool.bytes, kPoolSize)) {
+      pool.pos = kPoolSize;
+      return false;
+    }
+    pool.pos = 0;
+    pool.generation = generation;
+  }
+  memcpy(dst, pool.bytes + pool.pos, n);
+  pool.pos += n;
+  return true;
+}
+
+static bool all_zero(const uint8_t* p, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    if (p[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//
+// fill an op ID. an all-zero ID isn't valid so one is never returned.
+//
+bool op_id(uint8_t* dst) {
+  if (!enabled.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  do {
+    if (!take(dst, OBOE_MAX_OP_ID_LEN)) {
+      return false;
+    }
+  } while (all_zero(dst, OBOE_MAX_OP_ID_LEN));
+  return true;
+}
+
+//
+// initialize md with random task and op IDs, the equivalent of
+// oboe_metadata_init() followed by oboe_metadata_random().
+//
+bool random_metadata(oboe_metadata_t* md) {
+  if (!enabled.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  oboe_metadata_init(md);
+  do {
+    if (!take(md->ids.task_id, OBOE_MAX_TASK_ID_LEN)) {
+      return false;
+    }
+  } while (all_zero(md->ids.task_id, OBOE_MAX_TASK_ID_LEN));
+  return op_id(md->ids.op_id);
+}
+
+void set_enabled(bool enable) {
+  enabled.store(enable);
+}
+
+bool is_enabled() {
+  return enabled.load(std::memory_order_relaxed);
+}
+
+} // end namespace Ids
@@ -0,0 +1,366 @@
+#include "bindings.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+//
+// EventPool keeps the bson buffers of destroyed events so that new events
+// can reuse them instead of paying for a malloc() in oboe_event_init() and
+// a free() in oboe_event_destroy() for every event.
+//
+// oboe_event_init() writes a fixed prefix (the version and the X-Trace KV)
+// into each new buffer. a recycled buffer still holds that prefix, so reusing
+// it only requires rewinding the buffer and overwriting the X-Trace value.
+// the layout of the prefix is learned from events that oboe initializes, so
+// nothing about oboe's encoding is hardcoded here. if the layout can't be
+// confirmed the pool stays disabled and every event uses oboe_event_init().
+//
+// buffers are pooled by size class. class 0 is the size oboe_event_init()
+// allocates and the rest grow by alternating factors of 1.5 and 4/3, so the
+// classes double every two steps. new events take a class 0 buffer; an event
+// that's presized to a larger class swaps its buffer for a pooled one of that
+// class, so events of a Layer that's always presized the same way don't
+// realloc() at all. a released buffer whose size isn't a class size, because
+// oboe grew it, is shrunk to the class below it; one larger than the largest
+// class is shrunk to class 0. the prefix is at the start of the buffer so
+// shrinking keeps it.
+//
+// the layout is learned once for the process. the free buffers belong to the
+// thread that released them, so the main thread and each worker_thread keep
+// their own pool without locking; a thread's buffers are freed when it exits.
+//
+namespace EventPool {
+
+enum {
+  kLayoutUnknown = 0,       // no event has been seen yet
+  kLayoutCandidate = 1,     // one event seen, waiting for confirmation
+  kLayoutConfirmed = 2,     // buffers can be recycled
+  kLayoutInvalid = 3        // the prefix isn't understood; don't pool
+};
+
+// the X-Trace KV as bson encodes it: type string, key, nul.
+static const char kXTraceElement[] = "\x02X-Trace";
+
+// the layout is written only while learning, under learn_lock. once the
+// state is kLayoutConfirmed it doesn't change.
+static std::atomic<int> layout_state(kLayoutUnknown);
+static std::mutex learn_lock;
+static int buffer_size = 0;       // bufSize of a buffer from oboe_event_init()
+static size_t prefix_len = 0;     // bytes used by oboe_event_init()
+static size_t xtrace_offset = 0;  // offset of the X-Trace value's characters
+static size_t xtrace_len = 0;     // length of the X-Trace value (no nul)
+static std::string candidate;     // first prefix seen, used to confirm layout
+
+//
+// a thread's free buffers.
+//
+struct pool_t {
+  std::vector<char*> free_lists[kSizeClasses];
+  size_t available = 0;     // buffers in all the lists
+  size_t high_water_mark = kDefaultHighWaterMark;
+  size_t hits = 0;
+  size_t misses = 0;
+  size_t shrunk = 0;
+  size_t exchanged = 0;
+
+  ~pool_t() {
+    for (std::vector<char*>& free_list : free_lists) {
+      for (char* buf : free_list) {
+        oboe_bson_buffer b;
+        b.buf = buf;
+        oboe_bson_buffer_destroy(&b);
+      }
+    }
+  }
+};
+
+static thread_local pool_t pool;
+
+//
+// the size of the buffers in class k.
+//
+static size_t size_of_class(int k) {
+  const size_t base = (size_t)buffer_size << (k / 2);
+  return k & 1 ? base + base / 2 : base;
+}
+
+//
+// the largest class whose size is at most bytes, or -1 if bytes is smaller
+// than class 0.
+//
+static int class_at_most(size_t bytes) {
+  int k = kSizeClasses - 1;
+  while (k >= 0 && size_of_class(k) > bytes) {
+    k -= 1;
+  }
+  return k;
+}
+
+//
+// oboe allocates bson buffers with malloc() and grows them with realloc(),
+// so they can be resized the same way. the buffer is unchanged on failure.
+//
+static bool realloc_buffer(oboe_bson_buffer* bb, size_t size) {
+  char* buf = static_cast<char*>(realloc(bb->buf, size));
+  if (buf == NULL) {
+    return false;
+  }
+  bb->cur = buf + (bb->cur - bb->buf);
+  bb->buf = buf;
+  bb->bufSize = size;
+  return true;
+}
+
+//
+// find the X-Trace value in an event's buffer and verify that it matches
+// the event's metadata.
+//
+static bool find_xtrace(const oboe_event_t* ev, size_t* offset, size_t* len) {
+  char xt[OBOE_MAX_METADATA_PACK_LEN];
+  if (oboe_metadata_tostr(&ev->metadata, xt, sizeof(xt) - 1) != 0) {
+    return false;
+  }
+  const size_t n = strlen(xt);
+  const char* buf = ev->bbuf.buf;
+  const size_t used = ev->bbuf.cur - buf;
+  const size_t elen = sizeof(kXTraceElement);
+
+  // skip the bson document length; it isn't written until the buffer is
+  // finished.
+  for (size_t i = 4; i + elen + 4 + n + 1 <= used; i++) {
+    if (memcmp(buf + i, kXTraceElement, elen) != 0) {
+      continue;
+    }
+    int32_t slen;
+    memcpy(&slen, buf + i + elen, sizeof(slen));
+    const char* v = buf + i + elen + sizeof(slen);
+    if ((size_t)slen != n + 1 || memcmp(v, xt, n + 1) != 0) {
+      return false;
+    }
+    *offset = v - buf;
+    *len = n;
+    return true;
+  }
+  return false;
+}
+
+//
+// examine an event that oboe_event_init() just initialized. the first
+// event provides a candidate layout and the second must match it in every
+// byte except the X-Trace value before buffers are recycled.
+//
+void learn(const oboe_event_t* ev) {
+  int state = layout_state.load(std::memory_order_acquire);
+  if (state == kLayoutConfirmed || state == kLayoutInvalid) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(learn_lock);
+  if (layout_state == kLayoutConfirmed || layout_state == kLayoutInvalid) {
+    return;
+  }
+
+  size_t offset;
+  size_t len;
+  const size_t used = ev->bbuf.cur - ev->bbuf.buf;
+  if (!find_xtrace(ev, &offset, &len)) {
+    layout_state = kLayoutInvalid;
+    return;
+  }
+
+  if (layout_state == kLayoutUnknown) {
+    buffer_size = ev->bbuf.bufSize;
+    prefix_len = used;
+    xtrace_offset = offset;
+    xtrace_len = len;
+    candidate.assign(ev->bbuf.buf, used);
+    layout_state = kLayoutCandidate;
+    return;
+  }
+
+  const char* buf = ev->bbuf.buf;
+  const char* c = candidate.data();
+  const size_t tail = offset + len;
+  bool same = ev->bbuf.bufSize == buffer_size
+    && used == prefix_len
+    && offset == xtrace_offset
+    && len == xtrace_len
+    && memcmp(buf + 4, c + 4, offset - 4) == 0
+    && memcmp(buf + tail, c + tail, used - tail) == 0;
+
+  candidate.clear();
+  layout_state.store(same ? kLayoutConfirmed : kLayoutInvalid, std::memory_order_release);
+}
+
+//
+// initialize an event from a pooled buffer, the equivalent of
+// oboe_event_init(ev, md, op_id). returns false if there was no buffer
+// available, in which case the event is untouched.
+//
+bool acquire(oboe_event_t* ev, const oboe_metadata_t* md, const uint8_t* op_id) {
+  std::vector<char*>& free_list = pool.free_lists[0];
+  if (layout_state.load(std::memory_order_acquire) != kLayoutConfirmed || free_list.empty()) {
+    pool.misses += 1;
+    return false;
+  }
+
+  oboe_metadata_t omd = *md;
+
+  // like oboe_event_init() use the supplied op ID or make a random one.
+  if (op_id) {
+    memcpy(omd.ids.op_id, op_id, OBOE_MAX_OP_ID_LEN);
+  } else {
+    oboe_metadata_t random;
+    oboe_metadata_init(&random);
+    oboe_metadata_random(&random);
+    memcpy(omd.ids.op_id, random.ids.op_id, OBOE_MAX_OP_ID_LEN);
+  }
+
+  char xt[OBOE_MAX_METADATA_PACK_LEN];
+  if (oboe_metadata_tostr(&omd, xt, sizeof(xt) - 1) != 0 || strlen(xt) != xtrace_len) {
+    pool.misses += 1;
+    return false;
+  }
+
+  char* buf = free_list.back();
+  free_list.pop_back();
+  pool.available -= 1;
+
+  ev->metadata = omd;
+  ev->bbuf.buf = buf;
+  ev->bbuf.cur = buf + prefix_len;
+  ev->bbuf.bufSize = buffer_size;
+  ev->bbuf.finished = 0;
+  ev->bbuf.stackPos = 0;
+  ev->bb_str = NULL;
+  memcpy(buf + xtrace_offset, xt, xtrace_len);
+
+  pool.hits += 1;
+  return true;
+}
+
+//
+// take ownership of an event's bson buffer if the pool wants it. returns
+// false if the caller must still call oboe_event_destroy().
+//
+bool release(oboe_event_t* ev) {
+  if (layout_state.load(std::memory_order_acquire) != kLayoutConfirmed
+      || ev->bbuf.buf == NULL
+      || pool.available >= pool.high_water_mark) {
+    return false;
+  }
+  const size_t size = ev->bbuf.bufSize;
+  int k = class_at_most(size);
+  if (k < 0) {
+    return false;
+  }
+  if (k == kSizeClasses - 1 && size > size_of_class(k)) {
+    k = 0;
+  }
+  if (size != size_of_class(k)) {
+    if (!realloc_buffer(&ev->bbuf, size_of_class(k))) {
+      return false;
+    }
+    pool.shrunk += 1;
+  }
+
+  pool.free_lists[k].push_back(ev->bbuf.buf);
+  pool.available += 1;
+  ev->bbuf.buf = NULL;
+  ev->bbuf.cur = NULL;
+  ev->bbuf.bufSize = 0;
+  ev->bb_str = NULL;
+
+  return true;
+}
+
+//
+// the size of the smallest class that holds bytes, or 0 if buffers aren't
+// pooled or bytes is larger than the largest class.
+//
+size_t class_size(size_t bytes) {
+  if (layout_state.load(std::memory_order_acquire) != kLayoutConfirmed) {
+    return 0;
+  }
+  for (int k = 0; k < kSizeClasses; k++) {
+    if (size_of_class(k) >= bytes) {
+      return size_of_class(k);
+    }
+  }
+  return 0;
+}
+
+//
+// grow an event's buffer to size, a class size from class_size(). a pooled
+// buffer of that class is swapped in if there is one, and the event's
+// buffer goes back to the pool; otherwise the buffer is reallocated. sets
+// *swapped to say which. returns false if the buffer couldn't be grown.
+//
+bool grow(oboe_event_t* ev, size_t size, bool* swapped) {
+  *swapped = false;
+  int k = class_at_most(size);
+  if (k > 0 && size_of_class(k) == size && !pool.free_lists[k].empty()) {
+    char* buf = pool.free_lists[k].back();
+    pool.free_lists[k].pop_back();
+    pool.available -= 1;
+
+    // only the bytes written so far move; the nesting stack is offsets.
+    oboe_event_t old = *ev;
+    const size_t used = ev->bbuf.cur - ev->bbuf.buf;
+    memcpy(buf, ev->bbuf.buf, used);
+    ev->bbuf.buf = buf;
+    ev->bbuf.cur = buf + used;
+    ev->bbuf.bufSize = size;
+    if (!release(&old)) {
+      oboe_bson_buffer_destroy(&old.bbuf);
+    }
+    pool.exchanged += 1;
+    *swapped = true;
+    return true;
+  }
+  return realloc_buffer(&ev->bbuf, size);
+}
+
+//
+// set the maximum number of free buffers the calling thread holds. the pool
+// is trimmed, largest classes first, if it holds more than that. zero
+// disables pooling.
+//
+void set_high_water_mark(size_t n) {
+  pool.high_water_mark = n;
+  for (int k = kSizeClasses - 1; k >= 0 && pool.available > n; k--) {
+    std::vector<char*>& free_list = pool.free_lists[k];
+    while (!free_list.empty() && pool.available > n) {
+      oboe_bson_buffer b;
+      b.buf = free_list.back();
+      free_list.pop_back();
+      pool.available -= 1;
+      oboe_bson_buffer_destroy(&b);
+    }
+  }
+}
+
+size_t get_high_water_mark() {
+  return pool.high_water_mark;
+}
+
+stats_t get_stats() {
+  stats_t s;
+  s.hits = pool.hits;
+  s.misses = pool.misses;
+  s.available = pool.available;
+  s.shrunk = pool.shrunk;
+  s.exchanged = pool.exchanged;
+  s.buffer_size = layout_state.load() == kLayoutConfirmed ? buffer_size : 0;
+  return s;
+}
+
+void reset_stats() {
+  pool.hits = 0;
+  pool.misses = 0;
+  pool.shrunk = 0;
+  pool.exchanged = 0;
+}
+
+} // end namespace EventPool
@@ -0,0 +1,301 @@
+#include "bindings.h"
+#include "uv.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+//
+// SendQueue moves oboe_raw_send() off the JavaScript thread. finished bson
+// buffers, including ownership of their memory, are pushed onto a bounded
+// lock-free ring by any number of producers and drained by a single native
+// thread that sends and frees them.
+//
+// the ring is a bounded queue in which each cell carries a sequence number
+// that tells producers and the consumer whether the cell is free or full for
+// the current lap, so neither side takes a lock.
+//
+// there is one queue for the process. any environment (the main thread or a
+// worker_thread) can push to it, but it's stopped only by the environment
+// that started it.
+//
+namespace SendQueue {
+
+struct item_t {
+  int channel;
+  char* buf;          // the bson buffer; freed after sending
+  size_t len;         // bytes of the finished bson document
+  uint64_t queued;    // uv_hrtime() when queued
+};
+
+struct cell_t {
+  std::atomic<size_t> sequence;
+  item_t item;
+};
+
+static cell_t* cells = NULL;
+static size_t mask = 0;
+static std::atomic<size_t> ring_size(0);     // items the ring holds; 0 when stopped
+alignas(64) static std::atomic<size_t> enqueue_pos;
+alignas(64) static std::atomic<size_t> dequeue_pos;
+
+static std::atomic<bool> active(false);     // accepting items
+static std::atomic<bool> stopping(false);   // consumer should exit when empty
+static std::atomic<bool> sleeping(false);   // consumer is waiting on wakeup
+static std::atomic<int> pushing(0);         // producers inside push()
+static uv_sem_t wakeup;
+static uv_thread_t consumer;
+static napi_env owner_env = NULL;
+static std::mutex control;         // serializes start() and stop()
+
+// stats
+static std::atomic<uint64_t> queued(0);
+static std::atomic<uint64_t> sent(0);
+static std::atomic<uint64_t> drops(0);
+static std::atomic<uint64_t> send_errors(0);
+static std::atomic<uint64_t> latency_total(0);   // nanoseconds
+static std::atomic<uint64_t> latency_max(0);     // nanoseconds
+static std::mutex sample;                        // serializes get_stats(), which any thread can call
+static uint64_t psent = 0;                       // sent at the previous get_stats()
+static uint64_t platency_total = 0;              // latency_total at the previous get_stats()
+
+static bool pop(item_t* item) {
+  size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+  cell_t* cell = &cells[pos & mask];
+  size_t seq = cell->sequence.load(std::memory_order_acquire);
+  if ((intptr_t)seq - (intptr_t)(pos + 1) < 0) {
+    return false;
+  }
+  dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+  *item = cell->item;
+  cell->sequence.store(pos + mask + 1, std::memory_order_release);
+  return true;
+}
+
+static void free_buffer(char* buf) {
+  oboe_bson_buffer b;
+  b.buf = buf;
+  oboe_bson_buffer_destroy(&b);
+}
+
+static void send(const item_t& item) {
+  int status = oboe_raw_send(item.channel, item.buf, item.len);
+  free_buffer(item.buf);
+
+  uint64_t latency = uv_hrtime() - item.queued;
+  latency_total += latency;
+  uint64_t max = latency_max.load(std::memory_order_relaxed);
+  while (latency > max && !latency_max.compare_exchange_weak(max, latency)) {}
+
+  if (status < 0) {
+    send_errors += 1;
+  }
+  sent += 1;
+}
+
+//
+// the consumer thread. it sleeps only after seeing an empty queue while
+// flagged as sleeping, so a producer that sees the flag will wake it.
+//
+static void drain(void* arg) {
+  item_t item;
+  for (;;) {
+    while (pop(&item)) {
+      send(item);
+    }
+    if (stopping.load()) {
+      break;
+    }
+    sleeping.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (pop(&item)) {
+      sleeping.store(false);
+      send(item);
+      continue;
+    }
+    uv_sem_wait(&wakeup);
+    sleeping.store(false);
+  }
+}
+
+static void cleanup(void* arg) {
+  stop();
+}
+
+//
+// start the consumer thread with a ring of at least capacity items.
+//
+bool start(napi_env env, size_t capacity) {
+  std::lock_guard<std::mutex> lock(control);
+  if (active.load() || capacity == 0) {
+    return false;
+  }
+
+  // the ring's size must be a power of two.
+  size_t size = 2;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  cells = new cell_t[size];
+  mask = size - 1;
+  for (size_t i = 0; i < size; i++) {
+    cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  enqueue_pos.store(0);
+  dequeue_pos.store(0);
+  ring_size.store(size);
+
+  stopping.store(false);
+  sleeping.store(false);
+  if (uv_sem_init(&wakeup, 0) != 0) {
+    ring_size.store(0);
+    delete[] cells;
+    cells = NULL;
+    return false;
+  }
+  if (uv_thread_create(&consumer, drain, NULL) != 0) {
+    uv_sem_destroy(&wakeup);
+    ring_size.store(0);
+    delete[] cells;
+    cells = NULL;
+    return false;
+  }
+
+  // make sure queued events are sent before the environment goes away.
+  owner_env = env;
+  napi_add_env_cleanup_hook(owner_env, cleanup, NULL);
+
+  active.store(true);
+  return true;
+}
+
+//
+// stop accepting items, send everything that was queued, and stop the
+// consumer thread.
+//
+bool stop() {
+  std::lock_guard<std::mutex> lock(control);
+  if (!active.exchange(false)) {
+    return false;
+  }
+
+  stopping.store(true);
+  uv_sem_post(&wakeup);
+  uv_thread_join(&consumer);
+
+  // wait for producers that got in before active was cleared, then send
+  // anything pushed after the consumer's last pop.
+  while (pushing.load() != 0) {
+    std::this_thread::yield();
+  }
+  item_t item;
+  while (pop(&item)) {
+    send(item);
+  }
+
+  uv_sem_destroy(&wakeup);
+  ring_size.store(0);
+  delete[] cells;
+  cells = NULL;
+
+  napi_remove_env_cleanup_hook(owner_env, cleanup, NULL);
+  owner_env = NULL;
+
+  return true;
+}
+
+//
+// true if env started the queue and is running it.
+//
+bool owned_by(napi_env env) {
+  std::lock_guard<std::mutex> lock(control);
+  return active.load() && owner_env == env;
+}
+
+bool running() {
+  return active.load(std::memory_order_relaxed);
+}
+
+//
+// any thread can call this, so it reads a copy of the ring's size rather
+// than cells and mask, which stop() frees.
+//
+size_t capacity() {
+  return ring_size.load();
+}
+
+//
+// queue a finished bson buffer. on success the queue owns buf. returns false
+// if the queue isn't running or is full, in which case the caller still
+// owns buf.
+//
+bool push(int channel, char* buf, size_t len) {
+  // stop() won't free the ring while pushing is non-zero.
+  pushing += 1;
+  if (!active.load()) {
+    pushing -= 1;
+    return false;
+  }
+
+  cell_t* cell;
+  size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+  for (;;) {
+    cell = &cells[pos & mask];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+    if (dif == 0) {
+      if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (dif < 0) {
+      drops += 1;
+      pushing -= 1;
+      return false;
+    } else {
+      pos = enqueue_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell->item.channel = channel;
+  cell->item.buf = buf;
+  cell->item.len = len;
+  cell->item.queued = uv_hrtime();
+  // count it before the consumer can see it so depth never goes negative.
+  queued += 1;
+  cell->sequence.store(pos + 1, std::memory_order_release);
+
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleeping.load() && sleeping.exchange(false)) {
+    uv_sem_post(&wakeup);
+  }
+  pushing -= 1;
+
+  return true;
+}
+
+//
+// latency values are for items sent since the previous call from any
+// environment.
+//
+stats_t get_stats() {
+  std::lock_guard<std::mutex> lock(sample);
+
+  stats_t s;
+  s.running = running();
+  s.capacity = capacity();
+  s.queued = queued.load();
+  s.sent = sent.load();
+  s.depth = s.queued - s.sent;
+  s.drops = drops.load();
+  s.send_errors = send_errors.load();
+
+  uint64_t total = latency_total.load();
+  uint64_t n = s.sent - psent;
+  s.average_latency = n ? (double)(total - platency_total) / n / 1000 : 0;
+  s.max_latency = latency_max.exchange(0) / 1000.0;
+  psent = s.sent;
+  platency_total = total;
+
+  return s;
+}
+
+} // end namespace SendQueue
@@ -18,14 +18,79 @@ Napi::Value Event::sendStatus(const Napi::CallbackInfo& info) {
 }
 
 //
-// Common code for sendReport and sendStatus.
+// Send an array of events in one call. the events are finalized and sent
+// in order. unless cached finalization is off they share one timestamp.
 //
-int Event::send_event_x(int channel) {
+// Event.sendBatch(events, channel)
+//
+// @param {Event[]} events
+// @param {number} [channel] - Event.SEND_EVENT (default) or Event.SEND_STATUS
+//
+// returns {Int32Array} the status of each event, as sendReport() would have
+// returned it. an element that isn't an Event gets -2000.
+//
+Napi::Value Event::sendBatch(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsArray()) {
+    Napi::TypeError::New(env, "events must be an array").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  int channel = OBOE_SEND_EVENT;
+  if (info.Length() > 1 && !info[1].IsUndefined()) {
+    channel = info[1].ToNumber().Int32Value();
+    if (channel != OBOE_SEND_EVENT && channel != OBOE_SEND_STATUS) {
+      Napi::RangeError::New(env, "invalid channel").ThrowAsJavaScriptException();
+      return env.Undefined();
+    }
+  }
+
+  Napi::Array events = info[0].As<Napi::Array>();
+  const uint32_t n = events.Length();
+  Napi::Int32Array statuses = Napi::Int32Array::New(env, n);
+
+  // the wall clock is read once for the batch. with cached finalization off
+  // each event gets oboe's timestamp instead.
+  const int64_t timestamp = Stamp::is_enabled() ? Stamp::now_us() : 0;
+
+  for (uint32_t i = 0; i < n; i++) {
+    Napi::Value v = events[i];
+    if (!v.IsObject() || !Event::isEvent(v.As<Napi::Object>())) {
+      statuses[i] = -2000;
+      continue;
+    }
+    Event* e = Napi::ObjectWrap<Event>::Unwrap(v.As<Napi::Object>());
+    statuses[i] = e->send_event_x(channel, timestamp);
+  }
+
+  return statuses;
+}
+
+//
+// Common code for sendReport, sendStatus and sendBatch. if timestamp is
+// zero the current time is used.
+//
+// unless disabled via Event.configure({cachedFinalize: false}) the timestamp
+// and hostname KVs are written by Stamp from a coarse clock and a cached copy
+// of the hostname element; oboe is used if Stamp can't write them.
+//
+int Event::send_event_x(int channel, int64_t timestamp) {
   // validate the oboe event. if it's the non-functional, metadata-only
   // event return an error status.
-  if (!initialized) {
+  if (!writable()) {
     return -2000;
   }
+  // a synchronous send leaves the finished buffer in place. it can't be
+  // added to or sent again; oboe_event_add_timestamp() refuses it so this is
+  // the status oboe's path returned.
+  if (this->event.bbuf.finished || this->event.bb_str) {
+    return -1000;
+  }
+  // encode any deferred KVs, leaving room for the timestamp and hostname.
+  if (!flush_deferred(kFinalizeReserve)) {
+    return kDeferredFailed;
+  }
   // fake up metadata so oboe can check it. change the op_id so it doesn't
   // match the event's in oboe's check.
   oboe_metadata_t omd = this->event.metadata;
@@ -34,13 +99,22 @@ int Event::send_event_x(int channel) {
   int status;
   size_t bb_size = this->event.bbuf.bufSize;
 
-  status = oboe_event_add_timestamp(&this->event);
-  if (status < 0) {
-    return -1000;
+  const bool cached = Stamp::is_enabled();
+  if (timestamp == 0 && cached) {
+    timestamp = Stamp::now_us();
   }
-  status = oboe_event_add_hostname(&this->event);
-  if (status < 0) {
-    return -1001;
+
+  if (timestamp == 0 || !Stamp::timestamp(&this->event, timestamp)) {
+    status = oboe_event_add_timestamp(&this->event);
+    if (status < 0) {
+      return -1000;
+    }
+  }
+  if (!cached || !Stamp::hostname(&this->event)) {
+    status = oboe_event_add_hostname(&this->event);
+    if (status < 0) {
+      return -1001;
+    }
   }
 
   // finalize the bson buffer and send the message
@@ -50,25 +124,41 @@ int Event::send_event_x(int channel) {
   // (it's possible that the buffer size could have changed due
   // to either of the previous event_add calls but if that is
   // common then there are bigger problems to worry about.)
-  if ((unsigned)this->event.bbuf.bufSize != bb_size) {
-    size_t delta = this->event.bbuf.bufSize - bb_size;
-    bytes_allocated += delta;
-    total_bytes_alloc += delta;
-  }
+  track_bufsize(bb_size);
 
   if (!this->event.bb_str) {
     return -1002;
   }
   size_t len = this->event.bbuf.cur - this->event.bbuf.buf;
+  size_t buf_size = this->event.bbuf.bufSize;
+
+  // if sending asynchronously the queue owns the buffer once it's accepted.
+  // if the queue is full or stopped in the meantime send it here, so the
+  // event is sent exactly once either way.
+  if (SendQueue::push(channel, this->event.bb_str, len)) {
+    forget_buffer();
+    status = len;
+  } else {
+    status = oboe_raw_send(channel, this->event.bb_str, len);
+  }
 
   // count them as bytes and sends regardless of whether the send
   // succeeds. the goal is to know actual sizes of the events, not
   // the size of the buffers allocated for them.
-  actual_bytes_used += len;
-  sent_count += 1;
+  data->actual_bytes_used += len;
+  data->sent_count += 1;
+  data->total_sent.add(1);
+  data->total_bytes_sent.add(len);
+  SizeEstimator::record(size_class, len, buf_size);
   send_time = uv_hrtime();
+  Histograms::record_sendtime(data->histograms, (send_time - creation_time + 500) / 1000);
+  Histograms::record_size(data->histograms, len);
 
-  status = oboe_raw_send(channel, this->event.bb_str, len);
+  // oboe has copied the message, or the queue owns it, so the buffer can be
+  // released now.
+  if (data->auto_dispose) {
+    dispose_x();
+  }
 
   return status;
 }
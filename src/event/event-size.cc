@@ -0,0 +1,131 @@
+#include "bindings.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//
+// SizeEstimator learns how big finished events are so new events can grow
+// their bson buffer once, to about the size they'll need, instead of
+// doubling it several times as KVs are added.
+//
+// events are grouped into size classes by their Layer KV or by the template
+// applied to them. each class keeps an exponentially weighted moving average
+// of the finished size and of the mean deviation from it, the way TCP
+// estimates round trip times. the prediction is the average plus two
+// deviations, which covers most events without reserving room for the
+// largest.
+//
+// the estimates are kept per thread so the main thread and each
+// worker_thread learn their own without locking. template handles are only
+// meaningful in the environment that created them anyway.
+//
+namespace SizeEstimator {
+
+struct estimate_t {
+  double mean;        // bytes
+  double dev;         // mean deviation, bytes
+  uint64_t samples;
+};
+
+// weight of a new sample.
+static const double kAlpha = 0.125;
+// samples needed before a class is used for predictions.
+static const uint64_t kMinSamples = 4;
+
+static thread_local std::vector<estimate_t> classes;
+static thread_local std::unordered_map<std::string, int> layer_classes;
+static thread_local std::unordered_map<uint32_t, int> template_classes;
+
+static thread_local stats_t stats = {0, 0, 0};
+
+static int new_class() {
+  if (classes.size() >= kMaxClasses) {
+    return -1;
+  }
+  estimate_t e = {0, 0, 0};
+  classes.push_back(e);
+  return classes.size() - 1;
+}
+
+//
+// get the size class for a Layer, creating it if needed. returns -1 if there
+// are too many classes.
+//
+int for_layer(const std::string& layer) {
+  auto found = layer_classes.find(layer);
+  if (found != layer_classes.end()) {
+    return found->second;
+  }
+  int id = new_class();
+  if (id >= 0) {
+    layer_classes[layer] = id;
+  }
+  return id;
+}
+
+//
+// get the size class for a template handle.
+//
+int for_template(uint32_t handle) {
+  auto found = template_classes.find(handle);
+  if (found != template_classes.end()) {
+    return found->second;
+  }
+  int id = new_class();
+  if (id >= 0) {
+    template_classes[handle] = id;
+  }
+  return id;
+}
+
+//
+// the number of bytes an event in class id is expected to need, or 0 if
+// there isn't enough history.
+//
+size_t predict(int id) {
+  if (id < 0 || (size_t)id >= classes.size() || classes[id].samples < kMinSamples) {
+    return 0;
+  }
+  const estimate_t& e = classes[id];
+  return (size_t)(e.mean + 2 * e.dev + 0.5);
+}
+
+//
+// record the finished size of an event in class id and the size of the
+// buffer that held it.
+//
+void record(int id, size_t used, size_t allocated) {
+  stats.sent += 1;
+  stats.wasted += allocated > used ? allocated - used : 0;
+
+  if (id < 0 || (size_t)id >= classes.size()) {
+    return;
+  }
+  estimate_t& e = classes[id];
+  const double x = used;
+  if (e.samples == 0) {
+    e.mean = x;
+    e.dev = x / 2;
+  } else {
+    const double err = x - e.mean;
+    e.mean += kAlpha * err;
+    e.dev += kAlpha * ((err < 0 ? -err : err) - e.dev);
+  }
+  e.samples += 1;
+}
+
+void count_presize() {
+  stats.presized += 1;
+}
+
+stats_t get_stats() {
+  return stats;
+}
+
+void reset_stats() {
+  stats.presized = 0;
+  stats.sent = 0;
+  stats.wasted = 0;
+}
+
+} // end namespace SizeEstimator
@@ -0,0 +1,201 @@
+#include "bindings.h"
+#include "uv.h"
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <sys/time.h>
+#include <time.h>
+
+//
+// Stamp appends the timestamp and hostname KVs to events without calling
+// oboe_event_add_timestamp() and oboe_event_add_hostname() for each event.
+//
+// the elements oboe appends are captured from a scratch buffer so the bytes
+// written here match oboe's exactly. the timestamp element's type, key and
+// units are learned once; if it isn't an 8 byte integer in microseconds or
+// milliseconds, timestamp() returns false and the caller uses oboe. the
+// hostname element is copied as is and recaptured periodically in case the
+// hostname changes.
+//
+// time comes from a clock_gettime() base plus uv_hrtime() deltas. each thread
+// keeps its own base and cached hostname so the hot path takes no locks.
+//
+namespace Stamp {
+
+// how often each thread resyncs its wall clock base (nanoseconds)
+static const uint64_t kClockResyncInterval = 1000000000;
+// how often each thread checks whether the hostname changed (nanoseconds)
+static const uint64_t kHostnameCheckInterval = 60 * (uint64_t)1000000000;
+
+static std::atomic<bool> enabled(true);
+
+static uv_once_t learn_once = UV_ONCE_INIT;
+static bool ts_learned = false;
+static std::string ts_prefix;     // the element's type byte and key
+static int64_t ts_divisor = 1;    // microseconds per unit of the value
+
+static uv_mutex_t host_lock;
+static std::string host_element;  // the hostname element as oboe encodes it
+static std::atomic<uint64_t> host_generation(0);
+
+//
+// microseconds since the epoch, straight from the system clock.
+//
+static int64_t wall_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//
+// capture the bytes that an oboe add function appends to a bson buffer.
+//
+static bool capture(int (*add)(oboe_event_t*), std::string* element) {
+  oboe_event_t scratch;
+  memset(&scratch, 0, sizeof(scratch));
+  if (!oboe_bson_buffer_init(&scratch.bbuf)) {
+    return false;
+  }
+
+  const size_t offset = scratch.bbuf.cur - scratch.bbuf.buf;
+  int status = add(&scratch);
+  const char* start = scratch.bbuf.buf + offset;
+  const size_t len = scratch.bbuf.cur - start;
+  if (status == 0 && len > 0) {
+    element->assign(start, len);
+  }
+
+  oboe_bson_buffer_destroy(&scratch.bbuf);
+  return status == 0 && len > 0;
+}
+
+static void learn() {
+  uv_mutex_init(&host_lock);
+
+  std::string ts;
+  int64_t before = wall_us();
+  bool ok = capture(oboe_event_add_timestamp, &ts);
+  int64_t after = wall_us();
+
+  // type byte, key and its nul, 8 byte value.
+  const size_t len = ts.length();
+  size_t key_len = ok && len > 10 ? strnlen(ts.data() + 1, len - 1) : 0;
+  char type = ok ? ts[0] : 0;
+  if (key_len && 1 + key_len + 1 + 8 == len && (type == oboe_bson_long || type == oboe_bson_date)) {
+    int64_t value;
+    memcpy(&value, ts.data() + len - 8, sizeof(value));
+    // figure out the units from the time it was written.
+    if (value >= before && value <= after) {
+      ts_divisor = 1;
+      ts_learned = true;
+    } else if (value >= before / 1000 && value <= after / 1000) {
+      ts_divisor = 1000;
+      ts_learned = true;
+    }
+    if (ts_learned) {
+      ts_prefix.assign(ts.data(), 1 + key_len + 1);
+    }
+  }
+}
+
+//
+// recapture the hostname element and publish it if it changed.
+//
+static void refresh_hostname() {
+  std::string element;
+  if (!capture(oboe_event_add_hostname, &element)) {
+    return;
+  }
+  uv_mutex_lock(&host_lock);
+  if (element != host_element) {
+    host_element = element;
+    host_generation += 1;
+  }
+  uv_mutex_unlock(&host_lock);
+}
+
+void set_enabled(bool enable) {
+  enabled.store(enable);
+}
+
+bool is_enabled() {
+  return enabled.load(std::memory_order_relaxed);
+}
+
+//
+// microseconds since the epoch from this thread's clock base plus the high
+// resolution time elapsed since the base was read.
+//
+int64_t now_us() {
+  static thread_local int64_t wall_base = 0;
+  static thread_local uint64_t hr_base = 0;
+
+  uint64_t hr = uv_hrtime();
+  if (wall_base == 0 || hr - hr_base > kClockResyncInterval) {
+    wall_base = wall_us();
+    hr_base = hr;
+  }
+  return wall_base + (int64_t)((hr - hr_base) / 1000);
+}
+
+//
+// append the timestamp KV with time us (microseconds since the epoch).
+// returns false if the element format isn't known, in which case the
+// caller must use oboe_event_add_timestamp().
+//
+bool timestamp(oboe_event_t* ev, int64_t us) {
+  uv_once(&learn_once, learn);
+  if (!ts_learned) {
+    return false;
+  }
+
+  const size_t len = ts_prefix.length() + sizeof(int64_t);
+  if (!oboe_bson_ensure_space(&ev->bbuf, len)) {
+    return false;
+  }
+  int64_t value = us / ts_divisor;
+  memcpy(ev->bbuf.cur, ts_prefix.data(), ts_prefix.length());
+  memcpy(ev->bbuf.cur + ts_prefix.length(), &value, sizeof(value));
+  ev->bbuf.cur += len;
+
+  return true;
+}
+
+//
+// append the cached hostname KV. returns false if it couldn't be captured,
+// in which case the caller must use oboe_event_add_hostname().
+//
+bool hostname(oboe_event_t* ev) {
+  static thread_local std::string local;
+  static thread_local uint64_t local_generation = 0;
+  static thread_local uint64_t checked = 0;
+
+  uv_once(&learn_once, learn);
+
+  uint64_t now = uv_hrtime();
+  if (checked == 0 || now - checked > kHostnameCheckInterval) {
+    checked = now;
+    refresh_hostname();
+  }
+
+  uint64_t generation = host_generation.load();
+  if (generation == 0) {
+    return false;
+  }
+  if (generation != local_generation) {
+    uv_mutex_lock(&host_lock);
+    local = host_element;
+    local_generation = host_generation.load();
+    uv_mutex_unlock(&host_lock);
+  }
+
+  if (!oboe_bson_ensure_space(&ev->bbuf, local.length())) {
+    return false;
+  }
+  memcpy(ev->bbuf.cur, local.data(), local.length());
+  ev->bbuf.cur += local.length();
+
+  return true;
+}
+
+} // end namespace Stamp
@@ -0,0 +1,292 @@
+#include "bindings.h"
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+//
+// ObjectEncoder appends a plain JavaScript object or array to a bson buffer
+// as a subdocument.
+//
+// the value is first read into a flat, pre-order list of nodes while the
+// exact encoded size is totaled, so the depth and size limits are enforced
+// before anything is written and the bson buffer grows at most once. strings
+// are held in a single arena rather than one allocation each.
+//
+// values are converted much as JSON.stringify() would convert them:
+// undefined, functions and symbols are omitted from objects and are null in
+// arrays, and objects other than arrays contribute their enumerable
+// properties. TypedArrays and Buffers are bson binary.
+//
+#define MAX_SAFE_INTEGER (pow(2, 53) - 1)
+
+namespace ObjectEncoder {
+
+enum {
+  kDouble,
+  kLong,
+  kBool,
+  kNull,
+  kString,
+  kBinary,
+  kObject,
+  kArray
+};
+
+struct node_t {
+  int type;
+  size_t key;         // arena offset of the key; unused for array elements
+  size_t data;        // arena offset of string or binary data
+  size_t len;         // bytes of binary data
+  uint32_t count;     // children of an object or array
+  union {
+    double d;
+    int64_t l;
+    bool b;
+  };
+};
+
+struct state_t {
+  napi_env env;
+  std::vector<node_t> nodes;
+  std::string arena;
+  size_t size;        // encoded bytes so far
+};
+
+// results of build()
+enum {
+  kAdded,
+  kSkipped,
+  kTooComplex
+};
+
+static size_t digits(uint32_t n) {
+  size_t d = 1;
+  while (n >= 10) {
+    n /= 10;
+    d += 1;
+  }
+  return d;
+}
+
+//
+// append a nul-terminated string to the arena; returns its offset and sets
+// len to its length.
+//
+static size_t add_string(state_t& s, const Napi::Value& v, size_t* len) {
+  size_t offset = s.arena.length();
+  napi_get_value_string_utf8(s.env, v, NULL, 0, len);
+  s.arena.resize(offset + *len + 1);
+  napi_get_value_string_utf8(s.env, v, &s.arena[offset], *len + 1, len);
+  return offset;
+}
+
+//
+// read one value into the node list. key is the arena offset of the key and
+// key_len its length (for array elements, the number of digits in the
+// index). depth is the nesting level of the value.
+//
+static int build(state_t& s, const Napi::Value& v, size_t key, size_t key_len, int depth) {
+  node_t n;
+  n.key = key;
+  n.count = 0;
+  // type byte, key, nul.
+  size_t size = 1 + key_len + 1;
+
+  if (v.IsBoolean()) {
+    n.type = kBool;
+    n.b = v.As<Napi::Boolean>().Value();
+    size += 1;
+  } else if (v.IsNumber()) {
+    const double d = v.As<Napi::Number>();
+    double d_int;
+    if (std::modf(d, &d_int) != 0 || d > MAX_SAFE_INTEGER || d < -MAX_SAFE_INTEGER) {
+      n.type = kDouble;
+      n.d = d;
+    } else {
+      n.type = kLong;
+      n.l = d;
+    }
+    size += 8;
+  } else if (v.IsString()) {
+    n.type = kString;
+    size_t len;
+    n.data = add_string(s, v, &len);
+    size += 4 + len + 1;
+  } else if (v.IsNull()) {
+    n.type = kNull;
+  } else if (v.IsTypedArray()) {
+    napi_typedarray_type type;
+    size_t length;
+    void* data;
+    napi_get_typedarray_info(s.env, v, &type, &length, &data, NULL, NULL);
+    n.type = kBinary;
+    n.len = length * v.As<Napi::TypedArray>().ElementSize();
+    n.data = s.arena.length();
+    s.arena.append(data ? (const char*)data : "", n.len);
+    // length, subtype, data.
+    size += 4 + 1 + n.len;
+  } else if (v.IsFunction() || v.IsSymbol()) {
+    // functions are objects too, but like symbols they're skipped.
+    return kSkipped;
+#if NAPI_VERSION > 5
+  } else if (v.Type() == napi_bigint) {
+    bool lossless;
+    napi_get_value_bigint_int64(s.env, v, &n.l, &lossless);
+    if (!lossless) {
+      return kTooComplex;
+    }
+    n.type = kLong;
+    size += 8;
+#endif
+  } else if (v.IsObject()) {
+    if (depth > kMaxDepth) {
+      return kTooComplex;
+    }
+    // length, children, nul.
+    size += 4 + 1;
+  } else {
+    return kSkipped;
+  }
+
+  s.size += size;
+  if (s.size > kMaxBytes) {
+    return kTooComplex;
+  }
+
+  const size_t index = s.nodes.size();
+  s.nodes.push_back(n);
+  if (!v.IsObject() || v.IsTypedArray()) {
+    return kAdded;
+  }
+
+  uint32_t count = 0;
+  if (v.IsArray()) {
+    s.nodes[index].type = kArray;
+    Napi::Array a = v.As<Napi::Array>();
+    const uint32_t length = a.Length();
+    for (uint32_t i = 0; i < length; i++) {
+      Napi::Value e = a.Get(i);
+      int status = build(s, e, 0, digits(i), depth + 1);
+      if (status == kSkipped) {
+        status = build(s, Napi::Env(s.env).Null(), 0, digits(i), depth + 1);
+      }
+      if (status == kTooComplex) {
+        return kTooComplex;
+      }
+      count += 1;
+    }
+  } else {
+    s.nodes[index].type = kObject;
+    Napi::Object o = v.As<Napi::Object>();
+    Napi::Array keys = o.GetPropertyNames();
+    const uint32_t length = keys.Length();
+    for (uint32_t i = 0; i < length; i++) {
+      Napi::Value k = keys[i];
+      size_t key_len;
+      size_t key_offset = add_string(s, k, &key_len);
+      int status = build(s, o.Get(k), key_offset, key_len, depth + 1);
+      if (status == kTooComplex) {
+        return kTooComplex;
+      }
+      if (status == kAdded) {
+        count += 1;
+      }
+    }
+  }
+  s.nodes[index].count = count;
+
+  return kAdded;
+}
+
+//
+// write node i and its children to b. returns the index of the node that
+// follows them, or 0 if oboe failed to append something.
+//
+static size_t encode(oboe_bson_buffer* b, const state_t& s, size_t i, const char* key) {
+  const node_t& n = s.nodes[i];
+  const char* arena = s.arena.data();
+  oboe_bson_buffer* ok = b;
+
+  switch (n.type) {
+  case kDouble:
+    ok = oboe_bson_append_double(b, key, n.d);
+    break;
+  case kLong:
+    ok = oboe_bson_append_long(b, key, n.l);
+    break;
+  case kBool:
+    ok = oboe_bson_append_bool(b, key, n.b);
+    break;
+  case kNull:
+    ok = oboe_bson_append_null(b, key);
+    break;
+  case kString:
+    ok = oboe_bson_append_string(b, key, arena + n.data);
+    break;
+  case kBinary:
+    ok = oboe_bson_append_binary(b, key, 0, arena + n.data, n.len);
+    break;
+  case kObject:
+  case kArray: {
+    ok = n.type == kObject
+      ? oboe_bson_append_start_object(b, key)
+      : oboe_bson_append_start_array(b, key);
+    size_t next = i + 1;
+    char index[16];
+    for (uint32_t c = 0; ok && c < n.count; c++) {
+      const char* k;
+      if (n.type == kArray) {
+        oboe_bson_numstr(index, c);
+        k = index;
+      } else {
+        k = arena + s.nodes[next].key;
+      }
+      next = encode(b, s, next, k);
+      if (!next) {
+        return 0;
+      }
+    }
+    if (!ok || !oboe_bson_append_finish_object(b)) {
+      return 0;
+    }
+    return next;
+  }
+  }
+
+  return ok ? i + 1 : 0;
+}
+
+//
+// append value, an object or array, to b as a subdocument named key.
+//
+// returns 0 on success, kLimitExceeded if value is nested too deeply or
+// would take too many bytes, or -1 if it couldn't be written.
+//
+int append(oboe_bson_buffer* b, const char* key, const Napi::Value& value) {
+  state_t s;
+  s.env = value.Env();
+  s.size = 0;
+
+  const size_t key_len = strlen(key);
+  if (build(s, value, 0, key_len, 1) != kAdded) {
+    return kLimitExceeded;
+  }
+
+  // one allocation at most for the whole subdocument.
+  if (!oboe_bson_ensure_space(b, s.size)) {
+    return -1;
+  }
+
+  // don't leave a partial subdocument behind if oboe fails.
+  const size_t used = b->cur - b->buf;
+  const int stack_pos = b->stackPos;
+  if (!encode(b, s, 0, key)) {
+    b->cur = b->buf + used;
+    b->stackPos = stack_pos;
+    return -1;
+  }
+  return 0;
+}
+
+} // end namespace ObjectEncoder
@@ -1,7 +1,10 @@
 #include "bindings.h"
+#include "event/hex.h"
+#include <cstring>
 
-// local function definition.
+// local function definitions.
 static int format(oboe_metadata_t* md, size_t len, char* buffer, uint flags);
+static uint style_flags(int style);
 
 //
 // Convert an event's metadata to a string representation.
@@ -18,22 +21,77 @@ Napi::Value Event::toString(const Napi::CallbackInfo& info) {
     rc = oboe_metadata_tostr(&this->event.metadata, buf, sizeof(buf) - 1);
   } else {
     int style = info[0].ToNumber().Int64Value();
-    int flags;
-    // make style 1 the previous default because ff_header alone is not very
-    // useful.
-    if (style == 1) {
-      flags = Event::ff_header | Event::ff_task | Event::ff_op |
-              Event::ff_flags | Event::ff_separators | Event::ff_lowercase;
-    } else {
-      // the style are the flags and the separator is a dash.
-      flags = style;
-    }
-    rc = format(&this->event.metadata, sizeof(buf), buf, flags) ? 0 : -1;
+    rc = format(&this->event.metadata, sizeof(buf), buf, style_flags(style)) ? 0 : -1;
   }
 
   return Napi::String::New(env, rc == 0 ? buf : "");
 }
 
+//
+// Write an event's metadata, formatted as toString() would, into an existing
+// buffer so no string is created. no terminating nul is written.
+//
+// event.writeTo(buffer, offset, fmt)
+//
+// @param {Buffer} buffer
+// @param {number} [offset] - where to start writing, default 0
+// @param {number} [fmt] - the toString() style. if omitted the format is the
+//   same as toString() with no arguments.
+//
+// returns {number} the number of bytes written
+//
+Napi::Value Event::writeTo(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsBuffer()) {
+    Napi::TypeError::New(env, "buffer must be a Buffer").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  Napi::Buffer<char> buffer = info[0].As<Napi::Buffer<char>>();
+
+  int64_t offset = 0;
+  if (info.Length() > 1 && !info[1].IsUndefined()) {
+    offset = info[1].ToNumber().Int64Value();
+  }
+  if (offset < 0 || (size_t)offset > buffer.Length()) {
+    Napi::RangeError::New(env, "offset out of range").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  uint flags = Event::ff_header | Event::ff_task | Event::ff_op | Event::ff_flags;
+  if (info.Length() > 2 && !info[2].IsUndefined()) {
+    flags = style_flags(info[2].ToNumber().Int64Value());
+  }
+
+  char buf[Event::fmtBufferSize];
+  int len = format(&this->event.metadata, sizeof(buf), buf, flags);
+  if (!len) {
+    return Napi::Number::New(env, 0);
+  }
+  // don't count the nul.
+  len -= 1;
+  if ((size_t)offset + len > buffer.Length()) {
+    Napi::RangeError::New(env, "buffer too small").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  memcpy(buffer.Data() + offset, buf, len);
+
+  return Napi::Number::New(env, len);
+}
+
+//
+// convert a toString() style argument to format flags.
+//
+uint style_flags(int style) {
+  // make style 1 the previous default because ff_header alone is not very
+  // useful.
+  if (style == 1) {
+    return Event::fmtHuman;
+  }
+  // the style are the flags and the separator is a dash.
+  return style;
+}
+
 //
 // core formatting code
 //
@@ -42,18 +100,11 @@ Napi::Value Event::toString(const Napi::CallbackInfo& info) {
 //
 int format(oboe_metadata_t* md, size_t len, char* buffer, uint flags) {
   char* b = buffer;
-  char base = (flags & Event::ff_lowercase ? 'a' : 'A') - 10;
+  const bool lowercase = flags & Event::ff_lowercase;
   const char sep = '-';
 
-  auto puthex = [&b, base](uint8_t byte) {
-    int digit = (byte >> 4);
-    digit += digit <= 9 ? '0' : base;
-    *b++ = (char)digit;
-    digit = byte & 0xF;
-    digit += digit <= 9 ? '0' : base;
-    *b++ = (char)digit;
-
-    return b;
+  auto puthex = [&b, lowercase](uint8_t byte) {
+    return Hex::encode(&byte, 1, b, lowercase);
   };
 
   // make sure there is enough room in the buffer.
@@ -88,15 +139,9 @@ int format(oboe_metadata_t* md, size_t len, char* buffer, uint flags) {
     }
   }
 
-  // place to hold pointer to each byte of task and/or op ids.
-  uint8_t* mdp;
-
   // put the task ID
   if (flags & Event::ff_task) {
-    mdp = (uint8_t*)&md->ids.task_id;
-    for (unsigned int i = 0; i < md->task_len; i++) {
-      b = puthex(*mdp++);
-    }
+    b = Hex::encode((uint8_t*)&md->ids.task_id, md->task_len, b, lowercase);
     if (flags & (Event::ff_op | Event::ff_flags | Event::ff_sample) &&
         separators) {
       *b++ = sep;
@@ -105,10 +150,7 @@ int format(oboe_metadata_t* md, size_t len, char* buffer, uint flags) {
 
   // put the op ID
   if (flags & Event::ff_op) {
-    mdp = (uint8_t*)&md->ids.op_id;
-    for (unsigned int i = 0; i < md->op_len; i++) {
-      b = puthex(*mdp++);
-    }
+    b = Hex::encode((uint8_t*)&md->ids.op_id, md->op_len, b, lowercase);
     if (flags & (Event::ff_flags | Event::ff_sample) && separators) {
       *b++ = sep;
     }
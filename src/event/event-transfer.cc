@@ -0,0 +1,211 @@
+#include "bindings.h"
+#include "uv.h"
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+//
+// moving an event between environments, e.g., from the main thread to a
+// worker_thread that finishes and sends it.
+//
+// detach() moves the event's oboe_event_t, including its bson buffer, into a
+// native record and returns a small ArrayBuffer naming the record. the
+// ArrayBuffer can be posted or transferred to another thread, where attach()
+// claims the record and wraps it in a new Event. the bson buffer itself is
+// never copied.
+//
+// records are kept in a process-wide registry keyed by a sequence number
+// rather than by address, so a handle can only be attached once and a stale
+// handle is rejected. each record also has a random token that the handle
+// must match, so a handle can't be forged from the sequence number alone.
+// a record that isn't attached within the lifetime, a minute by default, is
+// expired: attach() rejects it and it's freed, with its bson buffer, by
+// attach() or the next time an event is detached.
+//
+
+// "AOEV" little-endian.
+static const uint32_t kMagic = 0x56454f41;
+// how long a detached event waits to be attached (nanoseconds)
+static std::atomic<uint64_t> lifetime(Transfer::kDefaultLifetime * 1000000ULL);
+// how often the registry is checked for expired records (nanoseconds)
+static const uint64_t kSweepInterval = 1000000000ULL;
+
+struct handle_t {
+  uint32_t magic;
+  uint32_t reserved;
+  uint64_t id;
+  uint8_t token[OBOE_MAX_OP_ID_LEN];
+};
+
+struct detached_t {
+  oboe_event_t event;
+  uint64_t creation_time;
+  uint64_t detach_time;
+  uint8_t token[OBOE_MAX_OP_ID_LEN];
+};
+
+static std::mutex registry_lock;
+static std::unordered_map<uint64_t, detached_t*> registry;
+static uint64_t next_id = 1;
+static uint64_t last_sweep = 0;
+
+//
+// fill a token with random bytes from the pooled ID generator or, if that's
+// disabled, from oboe.
+//
+static void random_token(uint8_t* token) {
+  if (Ids::op_id(token)) {
+    return;
+  }
+  oboe_metadata_t md;
+  oboe_metadata_init(&md);
+  oboe_metadata_random(&md);
+  memcpy(token, md.ids.op_id, OBOE_MAX_OP_ID_LEN);
+}
+
+//
+// free the records that have waited longer than the lifetime. registry_lock
+// must be held.
+//
+static void sweep(uint64_t now) {
+  if (now - last_sweep < kSweepInterval) {
+    return;
+  }
+  last_sweep = now;
+  const uint64_t limit = lifetime.load(std::memory_order_relaxed);
+  for (auto it = registry.begin(); it != registry.end();) {
+    detached_t* d = it->second;
+    if (now - d->detach_time < limit) {
+      ++it;
+      continue;
+    }
+    oboe_event_destroy(&d->event);
+    delete d;
+    it = registry.erase(it);
+  }
+}
+
+//
+// JavaScript method to move the event's state out of the event so another
+// environment can attach() it. afterwards this event keeps its metadata but
+// can't be added to or sent.
+//
+// event.detach()
+//
+// returns an ArrayBuffer handle or undefined if the event has no bson buffer
+// (it was made from metadata only, disposed, detached or sent with
+// autoDispose) or its deferred KVs couldn't be encoded. the handle must be
+// attached within the lifetime set by Event.configure({detachedLifetime}).
+//
+Napi::Value Event::detach(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (!writable() || !flush_deferred()) {
+    return env.Undefined();
+  }
+
+  detached_t* d = new detached_t;
+  d->event = this->event;
+  d->creation_time = creation_time;
+  d->detach_time = uv_hrtime();
+  random_token(d->token);
+
+  handle_t h;
+  h.magic = kMagic;
+  h.reserved = 0;
+  memcpy(h.token, d->token, sizeof(h.token));
+  {
+    std::lock_guard<std::mutex> lock(registry_lock);
+    sweep(d->detach_time);
+    h.id = next_id++;
+    registry[h.id] = d;
+  }
+
+  // the buffer belongs to the record now.
+  forget_buffer();
+  disposed = true;
+
+  Napi::ArrayBuffer ab = Napi::ArrayBuffer::New(env, sizeof(h));
+  memcpy(ab.Data(), &h, sizeof(h));
+  return ab;
+}
+
+//
+// JavaScript function to make an Event from a handle returned by detach(),
+// typically in a different thread than the one that detached it.
+//
+// Event.attach(handle)
+//
+// @param {ArrayBuffer} handle
+//
+// returns the Event or undefined if the handle isn't valid, has expired or
+// has already been attached.
+//
+Napi::Value Event::attach(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() != 1 || !info[0].IsArrayBuffer()) {
+    Napi::TypeError::New(env, "handle must be an ArrayBuffer").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  Napi::ArrayBuffer ab = info[0].As<Napi::ArrayBuffer>();
+
+  handle_t h;
+  if (ab.ByteLength() != sizeof(h)) {
+    return env.Undefined();
+  }
+  memcpy(&h, ab.Data(), sizeof(h));
+  if (h.magic != kMagic) {
+    return env.Undefined();
+  }
+
+  detached_t* d;
+  {
+    std::lock_guard<std::mutex> lock(registry_lock);
+    auto found = registry.find(h.id);
+    if (found == registry.end() ||
+        memcmp(found->second->token, h.token, sizeof(h.token)) != 0) {
+      return env.Undefined();
+    }
+    d = found->second;
+    registry.erase(found);
+  }
+
+  if (uv_hrtime() - d->detach_time >= lifetime.load(std::memory_order_relaxed)) {
+    oboe_event_destroy(&d->event);
+    delete d;
+    return env.Undefined();
+  }
+
+  // start with an empty event and make it a full one.
+  Napi::Object o = Event::NewInstance(env);
+  Event* e = Napi::ObjectWrap<Event>::Unwrap(o);
+  e->data->small_active -= 1;
+  e->data->full_active += 1;
+
+  e->event = d->event;
+  e->initialized = true;
+  // lifetime and send time are measured from when the event was first made.
+  e->creation_time = d->creation_time;
+  delete d;
+
+  size_t bb_size = e->event.bbuf.bufSize;
+  e->bytes_allocated += bb_size;
+  e->data->total_bytes_alloc += bb_size;
+  e->report_external(bb_size);
+
+  return o;
+}
+
+namespace Transfer {
+
+void set_lifetime(uint64_t ms) {
+  lifetime.store(ms * 1000000ULL);
+}
+
+uint64_t get_lifetime() {
+  return lifetime.load() / 1000000ULL;
+}
+
+} // end namespace Transfer
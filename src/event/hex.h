@@ -0,0 +1,190 @@
+#ifndef EVENT_HEX_H_
+#define EVENT_HEX_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//
+// hex conversion for X-Trace strings. the vector versions convert 16 (SSE2)
+// or 32 (AVX2) characters at a time; anything left over, or everything when
+// neither is available, is done a byte at a time.
+//
+namespace Hex {
+
+//
+// the value of one hex digit, either case, or -1 if c isn't one.
+//
+inline int nibble(uint8_t c) {
+  if ((unsigned)(c - '0') <= 9) {
+    return c - '0';
+  }
+  uint8_t l = (c | 0x20) - 'a';
+  return l <= 5 ? l + 10 : -1;
+}
+
+#if defined(__SSE2__) || defined(__AVX2__)
+//
+// decode 16 hex characters into 8 bytes. returns false if any character
+// isn't a hex digit.
+//
+inline bool decode16(const char* src, uint8_t* dst) {
+  const __m128i v = _mm_loadu_si128((const __m128i*)src);
+
+  // unsigned x <= n is min(x, n) == x.
+  const __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+  const __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+  const __m128i l = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+  const __m128i is_alpha = _mm_cmpeq_epi8(_mm_min_epu8(l, _mm_set1_epi8(5)), l);
+
+  if (_mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha)) != 0xFFFF) {
+    return false;
+  }
+  const __m128i n = _mm_or_si128(
+    _mm_and_si128(is_digit, d),
+    _mm_and_si128(is_alpha, _mm_add_epi8(l, _mm_set1_epi8(10))));
+
+  // each 16 bit lane holds the high nibble in its low byte and the low
+  // nibble in its high byte.
+  const __m128i hi = _mm_slli_epi16(_mm_and_si128(n, _mm_set1_epi16(0x00FF)), 4);
+  const __m128i lo = _mm_srli_epi16(n, 8);
+  const __m128i bytes = _mm_packus_epi16(_mm_or_si128(hi, lo), _mm_setzero_si128());
+  _mm_storel_epi64((__m128i*)dst, bytes);
+
+  return true;
+}
+#endif
+
+#if defined(__AVX2__)
+//
+// decode 32 hex characters into 16 bytes.
+//
+inline bool decode32(const char* src, uint8_t* dst) {
+  const __m256i v = _mm256_loadu_si256((const __m256i*)src);
+
+  const __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+  const __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+  const __m256i l = _mm256_sub_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+  const __m256i is_alpha = _mm256_cmpeq_epi8(_mm256_min_epu8(l, _mm256_set1_epi8(5)), l);
+
+  if (_mm256_movemask_epi8(_mm256_or_si256(is_digit, is_alpha)) != -1) {
+    return false;
+  }
+  const __m256i n = _mm256_or_si256(
+    _mm256_and_si256(is_digit, d),
+    _mm256_and_si256(is_alpha, _mm256_add_epi8(l, _mm256_set1_epi8(10))));
+
+  const __m256i hi = _mm256_slli_epi16(_mm256_and_si256(n, _mm256_set1_epi16(0x00FF)), 4);
+  const __m256i lo = _mm256_srli_epi16(n, 8);
+  // the pack works within each 128 bit half, leaving 8 bytes in quadwords 0
+  // and 2.
+  const __m256i packed = _mm256_packus_epi16(_mm256_or_si256(hi, lo), _mm256_setzero_si256());
+  const __m256i bytes = _mm256_permute4x64_epi64(packed, 0x08);
+  _mm_storeu_si128((__m128i*)dst, _mm256_castsi256_si128(bytes));
+
+  return true;
+}
+#endif
+
+//
+// decode 2 * n hex characters from src into n bytes at dst. returns false,
+// with dst partially written, if src contains anything but hex digits.
+//
+inline bool decode(const char* src, size_t n, uint8_t* dst) {
+#if defined(__AVX2__)
+  for (; n >= 16; n -= 16, src += 32, dst += 16) {
+    if (!decode32(src, dst)) {
+      return false;
+    }
+  }
+#endif
+#if defined(__SSE2__) || defined(__AVX2__)
+  for (; n >= 8; n -= 8, src += 16, dst += 8) {
+    if (!decode16(src, dst)) {
+      return false;
+    }
+  }
+#endif
+  for (; n > 0; n -= 1, src += 2, dst += 1) {
+    int hi = nibble(src[0]);
+    int lo = nibble(src[1]);
+    if ((hi | lo) < 0) {
+      return false;
+    }
+    *dst = (uint8_t)(hi << 4 | lo);
+  }
+  return true;
+}
+
+#if defined(__SSE2__) || defined(__AVX2__)
+//
+// encode 8 bytes as 16 hex characters. alpha is the amount to add to
+// '0' + n to get the digit for n > 9.
+//
+inline void encode8(const uint8_t* src, char* dst, char alpha) {
+  const __m128i b = _mm_loadl_epi64((const __m128i*)src);
+  const __m128i mask = _mm_set1_epi8(0x0F);
+  const __m128i hi = _mm_and_si128(_mm_srli_epi16(b, 4), mask);
+  const __m128i lo = _mm_and_si128(b, mask);
+  const __m128i n = _mm_unpacklo_epi8(hi, lo);
+
+  const __m128i gt9 = _mm_cmpgt_epi8(n, _mm_set1_epi8(9));
+  __m128i c = _mm_add_epi8(n, _mm_set1_epi8('0'));
+  c = _mm_add_epi8(c, _mm_and_si128(gt9, _mm_set1_epi8(alpha)));
+  _mm_storeu_si128((__m128i*)dst, c);
+}
+#endif
+
+#if defined(__AVX2__)
+//
+// encode 16 bytes as 32 hex characters.
+//
+inline void encode16(const uint8_t* src, char* dst, char alpha) {
+  // widen each byte to 16 bits, then put its high nibble in the low byte
+  // and its low nibble in the high byte.
+  const __m256i w = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)src));
+  const __m256i mask = _mm256_set1_epi16(0x000F);
+  const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(w, 4), mask);
+  const __m256i lo = _mm256_slli_epi16(_mm256_and_si256(w, mask), 8);
+  const __m256i n = _mm256_or_si256(hi, lo);
+
+  const __m256i gt9 = _mm256_cmpgt_epi8(n, _mm256_set1_epi8(9));
+  __m256i c = _mm256_add_epi8(n, _mm256_set1_epi8('0'));
+  c = _mm256_add_epi8(c, _mm256_and_si256(gt9, _mm256_set1_epi8(alpha)));
+  _mm256_storeu_si256((__m256i*)dst, c);
+}
+#endif
+
+//
+// encode n bytes from src as 2 * n hex characters at dst. no terminating
+// nul is written. returns the end of the characters written.
+//
+inline char* encode(const uint8_t* src, size_t n, char* dst, bool lowercase) {
+  const char alpha = (lowercase ? 'a' : 'A') - 10 - '0';
+#if defined(__AVX2__)
+  for (; n >= 16; n -= 16, src += 16, dst += 32) {
+    encode16(src, dst, alpha);
+  }
+#endif
+#if defined(__SSE2__) || defined(__AVX2__)
+  for (; n >= 8; n -= 8, src += 8, dst += 16) {
+    encode8(src, dst, alpha);
+  }
+#endif
+  for (; n > 0; n -= 1, src += 1) {
+    int hi = *src >> 4;
+    int lo = *src & 0xF;
+    *dst++ = (char)(hi + '0' + (hi > 9 ? alpha : 0));
+    *dst++ = (char)(lo + '0' + (lo > 9 ? alpha : 0));
+  }
+  return dst;
+}
+
+} // end namespace Hex
+
+#endif // EVENT_HEX_H_
@@ -1,4 +1,7 @@
 #include "bindings.h"
+#include <climits>
+#include <cmath>
+#include <cstring>
 #include <vector>
 
 int64_t get_integer(Napi::Object, const char*, int64_t = 0);
@@ -85,7 +88,8 @@ Napi::Value send_span(const Napi::CallbackInfo& info, send_generic_span_t send_f
 
 enum SMFlags {
   kSMFlagsTesting = 1 << 0,
-  kSMFlagsNoop = 1 << 1
+  kSMFlagsNoop = 1 << 1,
+  kSMFlagsAggregate = 1 << 2
 };
 //
 // internal function used by sendMetric() (deprecated) and sendMetrics().
@@ -95,6 +99,7 @@ Napi::Value send_metrics_core (Napi::Env env, Napi::Array metrics, uint64_t flag
   const char* service_name = "";
   bool testing = flags & kSMFlagsTesting;
   bool noop = flags & kSMFlagsNoop;
+  bool aggregate = flags & kSMFlagsAggregate;
 
   Napi::Array errors = Napi::Array::New(env);
   Napi::Array echo;
@@ -175,19 +180,31 @@ Napi::Value send_metrics_core (Napi::Env env, Napi::Array metrics, uint64_t flag
     size_t tag_count = 0;
     Napi::Object tags;
     Napi::Array keys;
+    // tags given as an ID from internTags() are already converted.
+    const TagSets::tagset_t* interned = NULL;
 
     if (metric.Has("tags")) {
       Napi::Value v = metric.Get("tags");
-      if (!v.IsObject() || v.IsArray()) {
+      if (v.IsNumber()) {
+        interned = TagSets::get(v);
+        if (!interned) {
+          set_error("tags id not found");
+          continue;
+        }
+        if (testing) {
+          echoTags = TagSets::to_object(env, interned);
+        }
+      } else if (!v.IsObject() || v.IsArray()) {
         set_error("tags must be plain object");
         continue;
-      }
-      tags = v.As<Napi::Object>();
-      keys = tags.GetPropertyNames();
-      tag_count = keys.Length();
+      } else {
+        tags = v.As<Napi::Object>();
+        keys = tags.GetPropertyNames();
+        tag_count = keys.Length();
 
-      if (testing) {
-        echoTags = Napi::Object::New(env);
+        if (testing) {
+          echoTags = Napi::Object::New(env);
+        }
       }
     }
 
@@ -228,18 +245,37 @@ Napi::Value send_metrics_core (Napi::Env env, Napi::Array metrics, uint64_t flag
       continue;
     }
 
+    const oboe_metric_tag_t* send_tags = otags;
+    const std::vector<std::string>* tag_keys = &holdKeys;
+    const std::vector<std::string>* tag_values = &holdValues;
+    if (interned) {
+      send_tags = interned->otags.data();
+      tag_count = interned->otags.size();
+      tag_keys = &interned->keys;
+      tag_values = &interned->values;
+    }
+
+    // aggregated metrics are sent when the aggregator is flushed. the first
+    // one starts it. if it can't take the metric send it now.
+    if (aggregate && !Aggregator::running()) {
+      Aggregator::start(env);
+    }
+
     int status;
-    if (noop) {
+    if (aggregate && Aggregator::record(name, *tag_keys, *tag_values, add_host_tag,
+                                        is_summary, count, value)) {
+      status = 0;
+    } else if (noop) {
       status = 0;
     } else {
       if (is_summary) {
         status = oboe_custom_metric_summary(name.c_str(), value, count,
                                             add_host_tag, service_name,
-                                            otags, tag_count);
+                                            send_tags, tag_count);
       } else {
         status = oboe_custom_metric_increment(name.c_str(), count,
                                               add_host_tag, service_name,
-                                              otags, tag_count);
+                                              send_tags, tag_count);
       }
     }
 
@@ -300,12 +336,17 @@ Napi::Value send_metrics_core (Napi::Env env, Napi::Array metrics, uint64_t flag
 //                "increment" metric. contains the value, or sum of the
 //                values if count is greater than 1.
 // metric.addHostTag - boolean (overrides options.addHostTag if present)
-// metric.tags - object of {tag: value} pairs.
+// metric.tags - object of {tag: value} pairs or an ID from internTags().
 //
 //
 // c++ - process an array of metrics each with a fully specified set of tags
 //
-// aob.reporter.sendMetrics(increments, summaries)
+// aob.reporter.sendMetrics(metrics, options)
+//
+// options.aggregate - add the metrics to the native aggregator, which sends
+//                each series once per interval, instead of sending them now.
+// options.testing - return the metrics that were accepted in correct.
+// options.noop - don't call oboe.
 //
 Napi::Value sendMetrics(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
@@ -324,6 +365,7 @@ Napi::Value sendMetrics(const Napi::CallbackInfo& info) {
     Napi::Object options = info[1].As<Napi::Object>();
     if (options.Get("testing").ToBoolean()) flags |= kSMFlagsTesting;
     if (options.Get("noop").ToBoolean()) flags |= kSMFlagsNoop;
+    if (options.Get("aggregate").ToBoolean()) flags |= kSMFlagsAggregate;
   }
 
   Napi::Array metrics = info[0].As<Napi::Array>();
@@ -331,6 +373,144 @@ Napi::Value sendMetrics(const Napi::CallbackInfo& info) {
   return send_metrics_core(env, metrics, flags);
 }
 
+//
+// sendMetricsColumnar(columns, options)
+//
+// send a batch of metrics given as columns of typed arrays rather than as
+// objects. row i is the metric with name nameIds[i], count counts[i], etc.
+// names and tags are IDs from internName() and internTags() so the loop never
+// touches a JavaScript object or string.
+//
+// columns.nameIds - Uint32Array
+// columns.counts - Float64Array of integers from 1 to 2^31 - 1 (default: 1 for
+//                  each)
+// columns.values - Float64Array, the value of summary metrics (optional)
+// columns.tagIds - Uint32Array (default: 0, no tags)
+// columns.flags - Uint8Array of kColumnar* bits (default: 0)
+//
+// every column that's present must have at least as many elements as
+// nameIds.
+//
+// options.aggregate - add the metrics to the aggregator.
+// options.noop - don't call oboe.
+//
+// returns a Uint32Array of the indexes of the metrics that weren't sent.
+//
+enum ColumnarFlags {
+  kColumnarSummary = 1 << 0,
+  kColumnarHostTag = 1 << 1
+};
+
+Napi::Value sendMetricsColumnar(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  const char* service_name = "";
+
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "invalid signature for sendMetricsColumnar()")
+        .ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  Napi::Object columns = info[0].As<Napi::Object>();
+
+  // get a column's data if it's the right type and long enough. a missing
+  // optional column is NULL.
+  size_t rows = 0;
+  bool valid = true;
+  auto column = [&](const char* name, napi_typedarray_type type, bool required) -> void* {
+    Napi::Value v = columns.Get(name);
+    if (v.IsUndefined() && !required) {
+      return NULL;
+    }
+    // napi_get_typedarray_info() works for SharedArrayBuffer views too.
+    napi_typedarray_type actual;
+    size_t length;
+    void* data;
+    if (!v.IsTypedArray() ||
+        napi_get_typedarray_info(env, v, &actual, &length, &data, NULL, NULL) != napi_ok ||
+        actual != type) {
+      valid = false;
+      return NULL;
+    }
+    if (required) {
+      rows = length;
+    } else if (length < rows) {
+      valid = false;
+      return NULL;
+    }
+    return data;
+  };
+
+  const uint32_t* name_ids = static_cast<uint32_t*>(column("nameIds", napi_uint32_array, true));
+  const double* counts = static_cast<double*>(column("counts", napi_float64_array, false));
+  const double* values = static_cast<double*>(column("values", napi_float64_array, false));
+  const uint32_t* tag_ids = static_cast<uint32_t*>(column("tagIds", napi_uint32_array, false));
+  const uint8_t* row_flags = static_cast<uint8_t*>(column("flags", napi_uint8_array, false));
+
+  if (!valid) {
+    Napi::TypeError::New(env, "columns must be typed arrays of the right type and length")
+        .ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  bool aggregate = false;
+  bool noop = false;
+  if (info.Length() > 1 && info[1].IsObject()) {
+    Napi::Object options = info[1].As<Napi::Object>();
+    aggregate = options.Get("aggregate").ToBoolean();
+    noop = options.Get("noop").ToBoolean();
+  }
+  if (aggregate && !Aggregator::running()) {
+    Aggregator::start(env);
+  }
+
+  std::vector<uint32_t> failed;
+
+  for (size_t i = 0; i < rows; i++) {
+    const std::string* name = MetricNames::get(name_ids[i]);
+    const TagSets::tagset_t* tags = TagSets::get(tag_ids ? tag_ids[i] : 0);
+    double d = counts ? counts[i] : 1;
+    uint8_t flags = row_flags ? row_flags[i] : 0;
+    bool is_summary = flags & kColumnarSummary;
+    bool add_host_tag = flags & kColumnarHostTag;
+    double value = values && is_summary ? values[i] : 0;
+
+    // oboe takes an int count, so anything else fails rather than being
+    // truncated.
+    if (!name || !tags || !(d >= 1 && d <= INT_MAX) || d != std::floor(d) ||
+        (is_summary && !values)) {
+      failed.push_back(i);
+      continue;
+    }
+    int count = static_cast<int>(d);
+
+    int status;
+    if (aggregate && Aggregator::record(*name, tags->keys, tags->values, add_host_tag,
+                                        is_summary, count, value)) {
+      status = 0;
+    } else if (noop) {
+      status = 0;
+    } else if (is_summary) {
+      status = oboe_custom_metric_summary(name->c_str(), value, count,
+                                          add_host_tag, service_name,
+                                          tags->otags.data(), tags->otags.size());
+    } else {
+      status = oboe_custom_metric_increment(name->c_str(), count,
+                                            add_host_tag, service_name,
+                                            tags->otags.data(), tags->otags.size());
+    }
+
+    if (status != 0) {
+      failed.push_back(i);
+    }
+  }
+
+  Napi::Uint32Array result = Napi::Uint32Array::New(env, failed.size());
+  if (!failed.empty()) {
+    memcpy(result.Data(), failed.data(), failed.size() * sizeof(uint32_t));
+  }
+  return result;
+}
+
 //
 // sendMetric(name, object)
 //
@@ -340,10 +520,13 @@ Napi::Value sendMetrics(const Napi::CallbackInfo& info) {
 // object - an object containing optional parameters
 // object.count - the number of observations being reported (default: 1)
 // object.addHostTag - boolean - {host: hostname} to tags.
-// object.tags - an object containing {tag: value} pairs.
+// object.tags - an object containing {tag: value} pairs or an ID from
+//               internTags().
 // object.value - if present this call is a valued-based call and this contains
 //                the value, or sum of values if count is greater than 1, being
 //                reported.
+// object.aggregate - add the metric to the native aggregator rather than
+//                sending it now.
 //
 // there are two types of metrics:
 //   1) count-based - the number of times something has occurred (no value associated with this metric)
@@ -424,7 +607,7 @@ Napi::Value sendMetric (const Napi::CallbackInfo& info) {
   // tags
   if (o.Has("tags")) {
     v = o.Get("tags");
-    if (!v.IsObject() || v.IsArray()) {
+    if (!v.IsNumber() && (!v.IsObject() || v.IsArray())) {
       Napi::TypeError::New(env, "sendMetric() tags must be a plain object")
           .ThrowAsJavaScriptException();
       return env.Null();
@@ -435,6 +618,8 @@ Napi::Value sendMetric (const Napi::CallbackInfo& info) {
   int64_t flags = 0;
   // noop - don't call oboe if set.
   if (o.Get("noop").ToBoolean().Value()) flags |= kSMFlagsNoop;
+  // aggregate - send it with the rest of its series at the next flush.
+  if (o.Get("aggregate").ToBoolean().Value()) flags |= kSMFlagsAggregate;
 
   Napi::Array metrics_array = Napi::Array::New(env, 1);
   metrics_array[(uint32_t)0] = metric;
@@ -462,6 +647,117 @@ Napi::Value sendMetric (const Napi::CallbackInfo& info) {
   return Napi::Number::New(env, -error);
 }
 
+//
+// configureAggregator(options)
+//
+// options.interval - milliseconds between flushes of the aggregator. 0 stops
+//                aggregating; metrics sent with aggregate are sent directly.
+//
+// returns the settings in effect.
+//
+Napi::Value configureAggregator (const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() > 0 && (!info[0].IsObject() || info[0].IsArray())) {
+    Napi::TypeError::New(env, "configureAggregator() options must be a plain object")
+        .ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  if (info.Length() > 0) {
+    Napi::Object o = info[0].As<Napi::Object>();
+    Napi::Value v = o.Get("interval");
+    if (!v.IsUndefined()) {
+      if (!v.IsNumber() || v.As<Napi::Number>().DoubleValue() < 0) {
+        Napi::TypeError::New(env, "interval must be a non-negative number")
+            .ThrowAsJavaScriptException();
+        return env.Undefined();
+      }
+      uint32_t interval = v.As<Napi::Number>().Uint32Value();
+      Aggregator::set_interval(env, interval);
+      if (interval == 0 && Aggregator::owned_by(env)) {
+        Aggregator::stop();
+      }
+    }
+  }
+
+  Napi::Object settings = Napi::Object::New(env);
+  settings.Set("interval", Napi::Number::New(env, Aggregator::get_interval()));
+  settings.Set("running", Napi::Boolean::New(env, Aggregator::running()));
+  return settings;
+}
+
+//
+// flushAggregator(options)
+//
+// send what the aggregator and this environment's registered counters and
+// summaries hold now rather than waiting for the interval.
+//
+// options.testing - return the series in series.
+// options.noop - don't call oboe.
+//
+// returns {sent, errors} counts of series.
+//
+Napi::Value flushAggregator (const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  bool testing = false;
+  bool noop = false;
+  if (info.Length() > 0 && info[0].IsObject()) {
+    Napi::Object options = info[0].As<Napi::Object>();
+    testing = options.Get("testing").ToBoolean();
+    noop = options.Get("noop").ToBoolean();
+  }
+
+  std::vector<Aggregator::series_t> series;
+  size_t errors = Aggregator::flush(&series, noop);
+  errors += Handles::flush(&series, noop);
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("sent", Napi::Number::New(env, series.size() - errors));
+  result.Set("errors", Napi::Number::New(env, errors));
+
+  if (testing) {
+    Napi::Array echo = Napi::Array::New(env, series.size());
+    for (size_t i = 0; i < series.size(); i++) {
+      const Aggregator::series_t& s = series[i];
+      Napi::Object m = Napi::Object::New(env);
+      m.Set("name", Napi::String::New(env, s.name));
+      m.Set("count", Napi::Number::New(env, s.count));
+      if (s.summary) {
+        m.Set("value", Napi::Number::New(env, s.sum));
+        m.Set("min", Napi::Number::New(env, s.min));
+        m.Set("max", Napi::Number::New(env, s.max));
+      }
+      m.Set("addHostTag", Napi::Boolean::New(env, s.host_tag));
+      if (s.keys.size() > 0) {
+        Napi::Object tags = Napi::Object::New(env);
+        for (size_t k = 0; k < s.keys.size(); k++) {
+          tags.Set(s.keys[k], s.values[k]);
+        }
+        m.Set("tags", tags);
+      }
+      echo[i] = m;
+    }
+    result.Set("series", echo);
+  }
+
+  return result;
+}
+
+Napi::Value getAggregatorStats (const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Aggregator::stats_t stats = Aggregator::get_stats();
+
+  Napi::Object o = Napi::Object::New(env);
+  o.Set("series", Napi::Number::New(env, stats.series));
+  o.Set("recorded", Napi::Number::New(env, stats.recorded));
+  o.Set("overflows", Napi::Number::New(env, stats.overflows));
+  o.Set("flushed", Napi::Number::New(env, stats.flushed));
+  o.Set("sendErrors", Napi::Number::New(env, stats.send_errors));
+  return o;
+}
+
 //
 // lambda additions
 //
@@ -496,6 +792,29 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
   module.Set("sendMetric", Napi::Function::New(env, sendMetric));
   module.Set("sendMetrics", Napi::Function::New(env, sendMetrics));
 
+  module.Set("configureAggregator", Napi::Function::New(env, configureAggregator));
+  module.Set("flushAggregator", Napi::Function::New(env, flushAggregator));
+  module.Set("getAggregatorStats", Napi::Function::New(env, getAggregatorStats));
+
+  module.Set("internTags", Napi::Function::New(env, TagSets::internTags));
+  module.Set("internName", Napi::Function::New(env, MetricNames::internName));
+  module.Set("sendMetricsColumnar", Napi::Function::New(env, sendMetricsColumnar));
+  module.Set("COLUMNAR_SUMMARY", Napi::Number::New(env, kColumnarSummary));
+  module.Set("COLUMNAR_HOST_TAG", Napi::Number::New(env, kColumnarHostTag));
+
+  module.Set("registerCounter", Napi::Function::New(env, Handles::registerCounter));
+  module.Set("registerSummary", Napi::Function::New(env, Handles::registerSummary));
+
+  // createHistogram() finds the constructor in its data, which lives as long
+  // as the environment.
+  Napi::Function histogram = MetricHistogram::Define(env);
+  Napi::FunctionReference* constructor = new Napi::FunctionReference(Napi::Persistent(histogram));
+  napi_add_env_cleanup_hook(env, [](void* arg) {
+    delete static_cast<Napi::FunctionReference*>(arg);
+  }, constructor);
+  module.Set("Histogram", histogram);
+  module.Set("createHistogram", Napi::Function::New(env, MetricHistogram::create, "createHistogram", constructor));
+
   module.Set("flush", Napi::Function::New(env, flush));
   module.Set("getType", Napi::Function::New(env, getType));
 
@@ -0,0 +1,288 @@
+#include "bindings.h"
+#include "uv.h"
+#include <algorithm>
+#include <climits>
+#include <mutex>
+
+//
+// Aggregator combines custom metrics in the process so oboe is called once
+// per series per interval rather than once per metric. a series is a name,
+// a set of tags and whether the host tag is added; increments sum their
+// counts and summaries keep count, sum, min and max.
+//
+// a uv timer on the loop of the environment that started the aggregator
+// flushes it. any environment can record. a series that's idle for a whole
+// interval is dropped at the next flush so the table only holds the series
+// in use.
+//
+namespace Aggregator {
+
+static const char* service_name = "";
+
+static std::mutex table_lock;
+static std::unordered_map<std::string, series_t> table;
+
+static std::mutex control;          // serializes start(), stop() and interval changes
+static uv_timer_t* timer = NULL;
+static napi_env owner_env = NULL;
+static std::atomic<bool> active(false);
+static uint32_t interval = kDefaultInterval;
+
+// stats
+static std::atomic<uint64_t> recorded(0);
+static std::atomic<uint64_t> overflows(0);
+static std::atomic<uint64_t> flushed(0);
+static std::atomic<uint64_t> send_errors(0);
+
+// scratch space for building keys, so recording doesn't allocate once the
+// series exists.
+static thread_local std::string key;
+static thread_local std::vector<uint32_t> order;
+
+//
+// build the key for a series in key and the tag order, sorted by tag key,
+// in order.
+//
+static void make_key(const std::string& name, const std::vector<std::string>& keys,
+                     const std::vector<std::string>& values, bool host_tag, bool summary) {
+  const size_t n = keys.size();
+  order.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return keys[a] < keys[b];
+  });
+
+  key.assign(name);
+  key.push_back('\0');
+  key.push_back(host_tag ? 'h' : '-');
+  key.push_back(summary ? 's' : 'i');
+  for (uint32_t i : order) {
+    key.push_back('\0');
+    key.append(keys[i]);
+    key.push_back('\0');
+    key.append(values[i]);
+  }
+}
+
+//
+// add an observation to a series. returns false if the series is new and
+// the table is full or the aggregator isn't running, in which case the
+// caller should send the metric directly.
+//
+bool record(const std::string& name, const std::vector<std::string>& keys,
+            const std::vector<std::string>& values, bool host_tag, bool summary,
+            int64_t count, double value) {
+  if (!active.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  make_key(name, keys, values, host_tag, summary);
+
+  std::lock_guard<std::mutex> lock(table_lock);
+  auto found = table.find(key);
+  if (found == table.end()) {
+    if (table.size() >= kMaxSeries) {
+      overflows += 1;
+      return false;
+    }
+    series_t s;
+    s.name = name;
+    for (uint32_t i : order) {
+      s.keys.push_back(keys[i]);
+      s.values.push_back(values[i]);
+    }
+    s.host_tag = host_tag;
+    s.summary = summary;
+    found = table.emplace(key, std::move(s)).first;
+  }
+
+  series_t& s = found->second;
+  if (s.count == 0) {
+    s.min = value;
+    s.max = value;
+  } else if (value < s.min) {
+    s.min = value;
+  } else if (value > s.max) {
+    s.max = value;
+  }
+  s.count += count;
+  s.sum += value;
+
+  recorded.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+//
+// send a series to oboe. returns oboe's status.
+//
+int send(const series_t& s) {
+  const size_t n = s.keys.size();
+  std::vector<oboe_metric_tag_t> otags(n);
+  for (size_t i = 0; i < n; i++) {
+    otags[i].key = (char*)s.keys[i].c_str();
+    otags[i].value = (char*)s.values[i].c_str();
+  }
+
+  // oboe's count is an int.
+  int count = s.count > INT_MAX ? INT_MAX : s.count;
+
+  if (s.summary) {
+    return oboe_custom_metric_summary(s.name.c_str(), s.sum, count, s.host_tag,
+                                      service_name, otags.data(), n);
+  }
+  return oboe_custom_metric_increment(s.name.c_str(), count, s.host_tag,
+                                      service_name, otags.data(), n);
+}
+
+//
+// send every series with observations since the last flush and reset them.
+// if out isn't NULL the series are appended to it. if noop is set nothing is
+// sent to oboe. returns the number of series that failed to send.
+//
+size_t flush(std::vector<series_t>* out, bool noop) {
+  std::vector<series_t> batch;
+  {
+    std::lock_guard<std::mutex> lock(table_lock);
+    batch.reserve(table.size());
+    for (auto it = table.begin(); it != table.end();) {
+      series_t& s = it->second;
+      if (s.count == 0) {
+        it = table.erase(it);
+        continue;
+      }
+      batch.push_back(s);
+      s.count = 0;
+      s.sum = 0;
+      ++it;
+    }
+  }
+
+  size_t errors = 0;
+  for (const series_t& s : batch) {
+    if (!noop && send(s) != OBOE_CUSTOM_METRICS_OK) {
+      errors += 1;
+    }
+  }
+  flushed += batch.size() - errors;
+  send_errors += errors;
+
+  if (out) {
+    out->insert(out->end(), batch.begin(), batch.end());
+  }
+  return errors;
+}
+
+static void on_timer(uv_timer_t* handle) {
+  flush(NULL, false);
+}
+
+static void on_close(uv_handle_t* handle) {
+  delete reinterpret_cast<uv_timer_t*>(handle);
+}
+
+static void cleanup(void* arg) {
+  stop();
+}
+
+//
+// start flushing every interval milliseconds from env's event loop. the
+// timer doesn't keep the loop alive.
+//
+bool start(napi_env env) {
+  std::lock_guard<std::mutex> lock(control);
+  if (timer || interval == 0) {
+    return false;
+  }
+
+  uv_loop_t* loop;
+  if (napi_get_uv_event_loop(env, &loop) != napi_ok) {
+    return false;
+  }
+  uv_timer_t* t = new uv_timer_t;
+  if (uv_timer_init(loop, t) != 0) {
+    delete t;
+    return false;
+  }
+  uv_timer_start(t, on_timer, interval, interval);
+  uv_unref(reinterpret_cast<uv_handle_t*>(t));
+
+  // send what's been aggregated before the environment goes away.
+  owner_env = env;
+  napi_add_env_cleanup_hook(owner_env, cleanup, NULL);
+
+  timer = t;
+  active.store(true);
+  return true;
+}
+
+//
+// stop the timer and flush what's been aggregated. must be called from the
+// thread of the environment that started it.
+//
+bool stop() {
+  {
+    std::lock_guard<std::mutex> lock(control);
+    if (!timer) {
+      return false;
+    }
+    active.store(false);
+    uv_timer_stop(timer);
+    uv_close(reinterpret_cast<uv_handle_t*>(timer), on_close);
+    timer = NULL;
+
+    napi_remove_env_cleanup_hook(owner_env, cleanup, NULL);
+    owner_env = NULL;
+  }
+  flush(NULL, false);
+  return true;
+}
+
+//
+// true if env started the aggregator and is running it.
+//
+bool owned_by(napi_env env) {
+  std::lock_guard<std::mutex> lock(control);
+  return timer && owner_env == env;
+}
+
+bool running() {
+  return active.load(std::memory_order_relaxed);
+}
+
+//
+// set the flush interval. if env is running the aggregator the timer is
+// restarted with it, otherwise it applies the next time the aggregator is
+// started. zero means don't aggregate; metrics are sent directly. env must
+// be the calling thread's environment; its Handles timer is restarted too.
+//
+void set_interval(napi_env env, uint32_t ms) {
+  {
+    std::lock_guard<std::mutex> lock(control);
+    interval = ms;
+    if (timer && owner_env == env && ms) {
+      uv_timer_start(timer, on_timer, ms, ms);
+    }
+  }
+  Handles::update_interval();
+}
+
+uint32_t get_interval() {
+  std::lock_guard<std::mutex> lock(control);
+  return interval;
+}
+
+stats_t get_stats() {
+  stats_t stats;
+  {
+    std::lock_guard<std::mutex> lock(table_lock);
+    stats.series = table.size();
+  }
+  stats.recorded = recorded.load();
+  stats.overflows = overflows.load();
+  stats.flushed = flushed.load();
+  stats.send_errors = send_errors.load();
+  return stats;
+}
+
+} // end namespace Aggregator
@@ -0,0 +1,345 @@
+#include "bindings.h"
+#include "uv.h"
+#include <algorithm>
+
+//
+// Handles are metrics whose storage is a typed array over a SharedArrayBuffer
+// so JavaScript can update them without calling into the bindings. a counter
+// is an Int32Array of one element; it can be incremented with Atomics.add()
+// from any thread it's posted to, or with plain writes from one thread. a
+// summary is a Float64Array of [count, sum], written with plain writes by the
+// thread that registered it.
+//
+// each environment keeps its own handles and drains them from a uv timer on
+// its own loop every Aggregator interval: counters are swapped with zero
+// atomically and summaries, which only the same thread writes, are read and
+// cleared. non-zero values are sent to oboe. the environment's
+// MetricHistograms are flushed by the same timer.
+//
+// when the interval changes the timer of the environment that changed it is
+// restarted right away; other environments' timers pick up the new interval
+// when they next fire.
+//
+namespace Handles {
+
+struct handle_t {
+  Aggregator::series_t series;    // name, tags and what was drained
+  Napi::ObjectReference array;    // keeps the SharedArrayBuffer alive
+  int32_t* counter;               // counters
+  double* summary;                // summaries, [count, sum]
+};
+
+struct state_t {
+  napi_env env;
+  uv_timer_t* timer;
+  uint32_t interval;                  // the timer's repeat, milliseconds
+  std::vector<handle_t*> handles;
+  std::unordered_map<std::string, handle_t*> by_key;
+  std::vector<MetricHistogram*> histograms;
+};
+
+static thread_local state_t* state = NULL;
+
+//
+// move what's been recorded in h since it was last drained into its series.
+// returns false if nothing was.
+//
+static bool drain(handle_t* h) {
+  Aggregator::series_t& s = h->series;
+  if (h->counter) {
+    int32_t n = __atomic_exchange_n(h->counter, 0, __ATOMIC_SEQ_CST);
+    s.count = n > 0 ? n : 0;
+  } else {
+    s.count = h->summary[0] > 0 ? h->summary[0] : 0;
+    s.sum = h->summary[1];
+    h->summary[0] = 0;
+    h->summary[1] = 0;
+  }
+  return s.count > 0;
+}
+
+//
+// drain every handle of this thread's environment and send the non-zero
+// ones. if out isn't NULL the series are appended to it. if noop is set
+// nothing is sent to oboe. returns the number of series that failed to send.
+//
+size_t flush(std::vector<Aggregator::series_t>* out, bool noop) {
+  if (!state) {
+    return 0;
+  }
+  size_t errors = 0;
+  for (handle_t* h : state->handles) {
+    if (!drain(h)) {
+      continue;
+    }
+    if (!noop && Aggregator::send(h->series) != OBOE_CUSTOM_METRICS_OK) {
+      errors += 1;
+    }
+    if (out) {
+      out->push_back(h->series);
+    }
+  }
+  for (MetricHistogram* h : state->histograms) {
+    errors += h->flush(out, noop);
+  }
+  return errors;
+}
+
+static void on_timer(uv_timer_t* handle);
+
+//
+// the Aggregator interval, or its default if aggregation is off.
+//
+static uint32_t get_interval() {
+  uint32_t interval = Aggregator::get_interval();
+  return interval ? interval : Aggregator::kDefaultInterval;
+}
+
+//
+// restart this thread's timer if the interval has changed.
+//
+void update_interval() {
+  if (!state) {
+    return;
+  }
+  uint32_t interval = get_interval();
+  if (interval != state->interval) {
+    state->interval = interval;
+    uv_timer_start(state->timer, on_timer, interval, interval);
+  }
+}
+
+static void on_timer(uv_timer_t* handle) {
+  flush(NULL, false);
+  update_interval();
+}
+
+static void on_close(uv_handle_t* handle) {
+  delete reinterpret_cast<uv_timer_t*>(handle);
+}
+
+//
+// send what's left and free the environment's handles. histograms finalized
+// after this find no state and aren't flushed again.
+//
+static void cleanup(void* arg) {
+  flush(NULL, false);
+
+  uv_timer_stop(state->timer);
+  uv_close(reinterpret_cast<uv_handle_t*>(state->timer), on_close);
+  for (handle_t* h : state->handles) {
+    delete h;
+  }
+  delete state;
+  state = NULL;
+}
+
+//
+// create this thread's state and start its timer.
+//
+static bool init(napi_env env) {
+  uv_loop_t* loop;
+  if (napi_get_uv_event_loop(env, &loop) != napi_ok) {
+    return false;
+  }
+  uv_timer_t* t = new uv_timer_t;
+  if (uv_timer_init(loop, t) != 0) {
+    delete t;
+    return false;
+  }
+  uint32_t interval = get_interval();
+  uv_timer_start(t, on_timer, interval, interval);
+  uv_unref(reinterpret_cast<uv_handle_t*>(t));
+
+  state = new state_t;
+  state->env = env;
+  state->timer = t;
+  state->interval = interval;
+  napi_add_env_cleanup_hook(env, cleanup, NULL);
+  return true;
+}
+
+//
+// make a typed array of the named global type over a new SharedArrayBuffer.
+//
+static Napi::Value make_shared(Napi::Env env, const char* type, size_t bytes) {
+  Napi::Object global = env.Global();
+  Napi::Value sab = global.Get("SharedArrayBuffer");
+  if (!sab.IsFunction()) {
+    return env.Undefined();
+  }
+  Napi::Value buffer = sab.As<Napi::Function>().New({Napi::Number::New(env, bytes)});
+  return global.Get(type).As<Napi::Function>().New({buffer});
+}
+
+//
+// set the tags of s, sorted by key, from a {tag: value} object or an ID from
+// internTags(). undefined is no tags. returns false if v is neither.
+//
+bool set_tags(const Napi::Value& v, Aggregator::series_t* s) {
+  if (v.IsUndefined()) {
+    return true;
+  }
+  if (v.IsNumber()) {
+    const TagSets::tagset_t* set = TagSets::get(v);
+    if (!set) {
+      return false;
+    }
+    s->keys = set->keys;
+    s->values = set->values;
+    return true;
+  }
+  if (!v.IsObject() || v.IsArray()) {
+    return false;
+  }
+  Napi::Object o = v.As<Napi::Object>();
+  Napi::Array keys = o.GetPropertyNames();
+  std::vector<std::pair<std::string, std::string>> tags;
+  for (uint32_t i = 0; i < keys.Length(); i++) {
+    Napi::Value k = keys[i];
+    tags.emplace_back(k.ToString(), o.Get(k).ToString());
+  }
+  std::sort(tags.begin(), tags.end());
+
+  s->keys.clear();
+  s->values.clear();
+  for (const auto& tag : tags) {
+    s->keys.push_back(tag.first);
+    s->values.push_back(tag.second);
+  }
+  return true;
+}
+
+//
+// register(name, tags, options) for registerCounter() and registerSummary().
+//
+static Napi::Value register_handle(const Napi::CallbackInfo& info, bool summary) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "name must be a string").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  std::string name = info[0].As<Napi::String>();
+
+  Aggregator::series_t series;
+  series.name = name;
+  if (info.Length() > 1 && !set_tags(info[1], &series)) {
+    Napi::TypeError::New(env, "tags must be a plain object or an internTags() id").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  bool host_tag = false;
+  if (info.Length() > 2 && info[2].IsObject()) {
+    host_tag = info[2].As<Napi::Object>().Get("addHostTag").ToBoolean();
+  }
+
+  // the same metric gets the same storage.
+  std::string key = name;
+  key.push_back('\0');
+  key.push_back(host_tag ? 'h' : '-');
+  key.push_back(summary ? 's' : 'i');
+  for (size_t i = 0; i < series.keys.size(); i++) {
+    key.push_back('\0');
+    key.append(series.keys[i]);
+    key.push_back('\0');
+    key.append(series.values[i]);
+  }
+  if (state) {
+    auto found = state->by_key.find(key);
+    if (found != state->by_key.end()) {
+      return found->second->array.Value();
+    }
+    if (state->handles.size() >= kMaxHandles) {
+      Napi::Error::New(env, "too many registered metrics").ThrowAsJavaScriptException();
+      return env.Undefined();
+    }
+  }
+
+  Napi::Value array = summary ? make_shared(env, "Float64Array", 2 * sizeof(double))
+                              : make_shared(env, "Int32Array", sizeof(int32_t));
+  if (!array.IsTypedArray()) {
+    Napi::Error::New(env, "SharedArrayBuffer is not available").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  if (!state && !init(env)) {
+    Napi::Error::New(env, "can't start the metrics timer").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  handle_t* h = new handle_t;
+  h->series = std::move(series);
+  h->series.host_tag = host_tag;
+  h->series.summary = summary;
+  h->array = Napi::Persistent(array.As<Napi::Object>());
+  if (summary) {
+    h->counter = NULL;
+    h->summary = array.As<Napi::Float64Array>().Data();
+  } else {
+    h->counter = array.As<Napi::Int32Array>().Data();
+    h->summary = NULL;
+  }
+
+  state->handles.push_back(h);
+  state->by_key[key] = h;
+
+  return array;
+}
+
+//
+// JavaScript function to register a counter.
+//
+// Reporter.registerCounter(name, tags, options)
+//
+// @param {string} name
+// @param {object} [tags] {tag: value} pairs
+// @param {object} [options]
+// @param {boolean} [options.addHostTag]
+//
+// returns an Int32Array of one element. add to element 0 to count; the total
+// is sent and reset each interval.
+//
+Napi::Value registerCounter(const Napi::CallbackInfo& info) {
+  return register_handle(info, false);
+}
+
+//
+// JavaScript function to register a summary.
+//
+// Reporter.registerSummary(name, tags, options)
+//
+// takes the same arguments as registerCounter(). returns a Float64Array of
+// two elements; add the number of observations to element 0 and their sum
+// to element 1.
+//
+Napi::Value registerSummary(const Napi::CallbackInfo& info) {
+  return register_handle(info, true);
+}
+
+//
+// flush h with this environment's handles until it's removed.
+//
+bool add_histogram(napi_env env, MetricHistogram* h) {
+  if (!state && !init(env)) {
+    return false;
+  }
+  state->histograms.push_back(h);
+  return true;
+}
+
+void remove_histogram(MetricHistogram* h) {
+  if (!state) {
+    return;
+  }
+  std::vector<MetricHistogram*>& list = state->histograms;
+  for (size_t i = 0; i < list.size(); i++) {
+    if (list[i] == h) {
+      list[i] = list.back();
+      list.pop_back();
+      break;
+    }
+  }
+}
+
+} // end namespace Handles
@@ -0,0 +1,211 @@
+#include "bindings.h"
+#include "metrics/hdr_histogram.h"
+#include <cmath>
+#include <cstdio>
+
+//
+// MetricHistogram keeps the distribution of a custom metric so its tail isn't
+// lost the way it is when oboe reduces summaries to a sum and count. values
+// are recorded natively in an HDR histogram; at each flush of the
+// environment's Handles the configured percentiles, min and max are sent as
+// summaries named <name>.p50, <name>.min, etc., with the histogram's tags, and
+// the histogram is reset.
+//
+// values are integers; record in a unit, like microseconds, that gives the
+// resolution needed. values are clamped to [0, max].
+//
+
+//
+// JavaScript constructor
+//
+// new Reporter.Histogram(name, tags, options)
+//
+// @param {string} name
+// @param {object} [tags] {tag: value} pairs
+// @param {object} [options]
+// @param {number} [options.precision=2] significant figures, 1 to 5
+// @param {number} [options.max=3600000000] the largest value recorded
+// @param {number[]} [options.percentiles=[50, 90, 99]]
+// @param {boolean} [options.addHostTag]
+//
+MetricHistogram::MetricHistogram(const Napi::CallbackInfo& info) : Napi::ObjectWrap<MetricHistogram>(info) {
+  Napi::Env env = info.Env();
+  histogram = NULL;
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "name must be a string").ThrowAsJavaScriptException();
+    return;
+  }
+  series.name = info[0].As<Napi::String>();
+  series.summary = true;
+
+  if (info.Length() > 1 && !Handles::set_tags(info[1], &series)) {
+    Napi::TypeError::New(env, "tags must be a plain object or an internTags() id").ThrowAsJavaScriptException();
+    return;
+  }
+
+  int precision = kDefaultPrecision;
+  int64_t max = kDefaultMax;
+  percentiles = {50, 90, 99};
+
+  if (info.Length() > 2 && !info[2].IsUndefined()) {
+    if (!info[2].IsObject()) {
+      Napi::TypeError::New(env, "options must be an object").ThrowAsJavaScriptException();
+      return;
+    }
+    Napi::Object o = info[2].As<Napi::Object>();
+
+    Napi::Value v = o.Get("precision");
+    if (!v.IsUndefined()) {
+      precision = v.IsNumber() ? v.As<Napi::Number>().Int32Value() : 0;
+      if (precision < 1 || precision > 5) {
+        Napi::RangeError::New(env, "precision must be 1 to 5").ThrowAsJavaScriptException();
+        return;
+      }
+    }
+
+    v = o.Get("max");
+    if (!v.IsUndefined()) {
+      max = v.IsNumber() ? v.As<Napi::Number>().Int64Value() : 0;
+      if (max < 2) {
+        Napi::RangeError::New(env, "max must be at least 2").ThrowAsJavaScriptException();
+        return;
+      }
+    }
+
+    v = o.Get("percentiles");
+    if (!v.IsUndefined()) {
+      if (!v.IsArray()) {
+        Napi::TypeError::New(env, "percentiles must be an array").ThrowAsJavaScriptException();
+        return;
+      }
+      Napi::Array a = v.As<Napi::Array>();
+      percentiles.clear();
+      for (uint32_t i = 0; i < a.Length(); i++) {
+        Napi::Value p = a[i];
+        double pct = p.IsNumber() ? p.As<Napi::Number>().DoubleValue() : 0;
+        if (!(pct > 0 && pct <= 100)) {
+          Napi::RangeError::New(env, "percentiles must be greater than 0 and at most 100")
+              .ThrowAsJavaScriptException();
+          return;
+        }
+        percentiles.push_back(pct);
+      }
+    }
+
+    series.host_tag = o.Get("addHostTag").ToBoolean();
+  }
+
+  if (hdr_init(1, max, precision, &histogram) != 0) {
+    histogram = NULL;
+    Napi::Error::New(env, "can't allocate the histogram").ThrowAsJavaScriptException();
+    return;
+  }
+
+  if (!Handles::add_histogram(env, this)) {
+    hdr_close(histogram);
+    histogram = NULL;
+    Napi::Error::New(env, "can't start the metrics timer").ThrowAsJavaScriptException();
+    return;
+  }
+}
+
+//
+// send what's been recorded since the last flush.
+//
+MetricHistogram::~MetricHistogram() {
+  Handles::remove_histogram(this);
+  if (histogram) {
+    flush(NULL, false);
+    hdr_close(histogram);
+  }
+}
+
+//
+// JavaScript method to record a value.
+//
+// histogram.record(value)
+//
+Napi::Value MetricHistogram::record(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsNumber()) {
+    Napi::TypeError::New(env, "value must be a number").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  if (!histogram) {
+    return env.Undefined();
+  }
+
+  double v = info[0].As<Napi::Number>().DoubleValue();
+  int64_t value;
+  if (!(v > 0)) {
+    value = 0;
+  } else if (v >= histogram->highest_trackable_value) {
+    value = histogram->highest_trackable_value;
+  } else {
+    value = std::llround(v);
+  }
+  hdr_record_value(histogram, value);
+
+  return env.Undefined();
+}
+
+//
+// send the percentiles, min and max of what's been recorded since the last
+// flush and reset. nothing is sent if nothing was recorded.
+//
+size_t MetricHistogram::flush(std::vector<Aggregator::series_t>* out, bool noop) {
+  if (!histogram || histogram->total_count == 0) {
+    return 0;
+  }
+
+  size_t errors = 0;
+  auto send = [&](const std::string& suffix, int64_t value) {
+    Aggregator::series_t s = series;
+    s.name += suffix;
+    s.count = 1;
+    s.sum = value;
+    s.min = value;
+    s.max = value;
+    if (!noop && Aggregator::send(s) != OBOE_CUSTOM_METRICS_OK) {
+      errors += 1;
+    }
+    if (out) {
+      out->push_back(std::move(s));
+    }
+  };
+
+  for (double pct : percentiles) {
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".p%g", pct);
+    send(suffix, hdr_value_at_percentile(histogram, pct));
+  }
+  send(".min", hdr_min(histogram));
+  send(".max", hdr_max(histogram));
+
+  hdr_reset(histogram);
+  return errors;
+}
+
+Napi::Function MetricHistogram::Define(Napi::Env env) {
+  return DefineClass(env, "Histogram", {
+    InstanceMethod("record", &MetricHistogram::record),
+  });
+}
+
+//
+// JavaScript function to make a histogram.
+//
+// Reporter.createHistogram(name, tags, options)
+//
+// takes the same arguments as the Histogram constructor.
+//
+Napi::Value MetricHistogram::create(const Napi::CallbackInfo& info) {
+  Napi::FunctionReference* constructor = static_cast<Napi::FunctionReference*>(info.Data());
+  std::vector<napi_value> args;
+  for (size_t i = 0; i < info.Length(); i++) {
+    args.push_back(info[i]);
+  }
+  return constructor->New(args);
+}
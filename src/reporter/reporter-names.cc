@@ -0,0 +1,73 @@
+#include "bindings.h"
+#include <mutex>
+
+//
+// MetricNames interns custom metric names so sendMetricsColumnar() can refer
+// to them by ID. like TagSets the table is process-wide and names are never
+// freed.
+//
+namespace MetricNames {
+
+static std::mutex lock;                                   // serializes interning
+static std::unordered_map<std::string, uint32_t> ids;
+static std::atomic<const std::string*> table[kMaxNames];
+static std::atomic<uint32_t> count(0);
+
+//
+// get the ID of a name, interning it if it's new. returns -1 if the table is
+// full.
+//
+int64_t intern(const std::string& name) {
+  std::lock_guard<std::mutex> guard(lock);
+  auto found = ids.find(name);
+  if (found != ids.end()) {
+    return found->second;
+  }
+
+  uint32_t id = count.load();
+  if (id >= kMaxNames) {
+    return -1;
+  }
+  ids[name] = id;
+  table[id].store(new std::string(name), std::memory_order_release);
+  count.store(id + 1);
+  return id;
+}
+
+//
+// get a name by ID. returns NULL if there's no such name.
+//
+const std::string* get(uint32_t id) {
+  if (id >= kMaxNames) {
+    return NULL;
+  }
+  return table[id].load(std::memory_order_acquire);
+}
+
+//
+// JavaScript function to intern a metric name.
+//
+// Reporter.internName(name)
+//
+// @param {string} name
+//
+// returns an ID for the name in sendMetricsColumnar()'s nameIds. interning
+// the same name again returns the same ID.
+//
+Napi::Value internName(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() != 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "name must be a string").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  int64_t id = intern(info[0].As<Napi::String>());
+  if (id < 0) {
+    Napi::Error::New(env, "too many interned names").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  return Napi::Number::New(env, id);
+}
+
+} // end namespace MetricNames
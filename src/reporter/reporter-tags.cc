@@ -0,0 +1,143 @@
+#include "bindings.h"
+#include <algorithm>
+#include <mutex>
+
+//
+// TagSets interns the tag sets of custom metrics. each distinct set is
+// converted to strings once and kept, sorted by key, as an immutable
+// oboe_metric_tag_t array that metrics refer to by ID, so sending a metric
+// with interned tags needs no string conversion or allocation.
+//
+// the table is process-wide so an ID can be used by any environment. sets are
+// never freed. ID 0 is the empty set.
+//
+namespace TagSets {
+
+static std::mutex lock;                                   // serializes interning
+static std::unordered_map<std::string, uint32_t> ids;     // by signature
+static std::atomic<const tagset_t*> table[kMaxTagSets];
+static std::atomic<uint32_t> count(0);
+
+static const tagset_t* empty() {
+  static const tagset_t set;
+  return &set;
+}
+
+//
+// get the ID of a set of tags, interning it if it's new. the tags needn't be
+// sorted. returns -1 if the table is full.
+//
+int64_t intern(std::vector<std::pair<std::string, std::string>> tags) {
+  if (tags.empty()) {
+    return 0;
+  }
+  std::sort(tags.begin(), tags.end());
+
+  std::string signature;
+  for (const auto& tag : tags) {
+    signature.push_back('\0');
+    signature.append(tag.first);
+    signature.push_back('\0');
+    signature.append(tag.second);
+  }
+
+  std::lock_guard<std::mutex> guard(lock);
+  auto found = ids.find(signature);
+  if (found != ids.end()) {
+    return found->second;
+  }
+
+  // ID 0 is taken by the empty set.
+  uint32_t id = count.load() + 1;
+  if (id >= kMaxTagSets) {
+    return -1;
+  }
+
+  tagset_t* set = new tagset_t;
+  for (const auto& tag : tags) {
+    set->keys.push_back(tag.first);
+    set->values.push_back(tag.second);
+  }
+  // the strings don't move once the vectors are built.
+  set->otags.resize(tags.size());
+  for (size_t i = 0; i < tags.size(); i++) {
+    set->otags[i].key = const_cast<char*>(set->keys[i].c_str());
+    set->otags[i].value = const_cast<char*>(set->values[i].c_str());
+  }
+  set->signature = std::move(signature);
+
+  ids[set->signature] = id;
+  table[id].store(set, std::memory_order_release);
+  count.store(id);
+  return id;
+}
+
+//
+// get a tag set by ID. returns NULL if there's no such set.
+//
+const tagset_t* get(uint32_t id) {
+  if (id == 0) {
+    return empty();
+  }
+  if (id >= kMaxTagSets) {
+    return NULL;
+  }
+  return table[id].load(std::memory_order_acquire);
+}
+
+//
+// get a tag set from a JavaScript number. returns NULL if it isn't the ID of
+// a set.
+//
+const tagset_t* get(const Napi::Value& v) {
+  double d = v.As<Napi::Number>().DoubleValue();
+  if (!(d >= 0 && d < kMaxTagSets) || d != static_cast<uint32_t>(d)) {
+    return NULL;
+  }
+  return get(static_cast<uint32_t>(d));
+}
+
+Napi::Object to_object(Napi::Env env, const tagset_t* set) {
+  Napi::Object o = Napi::Object::New(env);
+  for (size_t i = 0; i < set->keys.size(); i++) {
+    o.Set(set->keys[i], set->values[i]);
+  }
+  return o;
+}
+
+//
+// JavaScript function to intern a set of tags.
+//
+// Reporter.internTags(tags)
+//
+// @param {object} tags {tag: value} pairs
+//
+// returns an ID that can be used in place of the tags object in sendMetrics(),
+// sendMetric(), registerCounter(), registerSummary() and createHistogram().
+// interning the same tags again returns the same ID.
+//
+Napi::Value internTags(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() != 1 || !info[0].IsObject() || info[0].IsArray()) {
+    Napi::TypeError::New(env, "tags must be a plain object").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  Napi::Object o = info[0].As<Napi::Object>();
+  Napi::Array keys = o.GetPropertyNames();
+
+  std::vector<std::pair<std::string, std::string>> tags;
+  for (uint32_t i = 0; i < keys.Length(); i++) {
+    Napi::Value k = keys[i];
+    tags.emplace_back(k.ToString(), o.Get(k).ToString());
+  }
+
+  int64_t id = intern(std::move(tags));
+  if (id < 0) {
+    Napi::Error::New(env, "too many interned tag sets").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  return Napi::Number::New(env, id);
+}
+
+} // end namespace TagSets
@@ -79,10 +79,12 @@ Napi::Value setDefaultSampleRate(const Napi::CallbackInfo& info) {
 //
 // getTraceSettings(object)
 //
-// object.xtrace - Metadata instance or undefined
+// object.xtrace - X-Trace string, 30 bytes of metadata or undefined
 // object.mode - a route-specific trace mode, 0 or 1 for 'never'
 // or 'always' object.rate - a route-specific sampling rate
 // object.edge - override the default edge setting.
+// object.compact - return metadata as 30 bytes of metadata in a Buffer
+// rather than as an Event.
 //
 Napi::Value getTraceSettings(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
@@ -98,6 +100,7 @@ Napi::Value getTraceSettings(const Napi::CallbackInfo& info) {
   int mode = -1;
   // edge back to supplied metadata unless there is none.
   bool edge = true;
+  bool compact = false;
 
   // debugging booleans
   //bool showIn = false;
@@ -120,7 +123,14 @@ Napi::Value getTraceSettings(const Napi::CallbackInfo& info) {
 
     // is an xtrace supplied?
     Napi::Value v = o.Get("xtrace");
-    if (v.IsString()) {
+    if (v.IsTypedArray()) {
+      // oboe needs the string form of binary metadata.
+      char str[OBOE_MAX_METADATA_PACK_LEN];
+      if (Event::metadata_from_value(v, &omd) && oboe_metadata_tostr(&omd, str, sizeof(str) - 1) == 0) {
+        xtrace = str;
+        have_metadata = true;
+      }
+    } else if (v.IsString()) {
       xtrace = v.As<Napi::String>();
 
       // make sure it's the right length before calling oboe.
@@ -158,6 +168,8 @@ Napi::Value getTraceSettings(const Napi::CallbackInfo& info) {
       edge = o.Get("edge").ToBoolean().Value();
     }
 
+    compact = o.Get("compact").ToBoolean().Value();
+
     // now handle x-trace-options and x-trace-options-signature
     v = o.Get("typeRequested");
     if (v.IsNumber()) {
@@ -244,8 +256,10 @@ Napi::Value getTraceSettings(const Napi::CallbackInfo& info) {
   have_metadata = out.sample_source == OBOE_SAMPLE_RATE_SOURCE_CONTINUED;
   if (!have_metadata) {
     edge = false;
-    oboe_metadata_init(&omd);
-    oboe_metadata_random(&omd);
+    if (!Ids::random_metadata(&omd)) {
+      oboe_metadata_init(&omd);
+      oboe_metadata_random(&omd);
+    }
   }
 
   // now we have oboe_metadata_t either from a supplied xtrace id or from
@@ -257,7 +271,9 @@ Napi::Value getTraceSettings(const Napi::CallbackInfo& info) {
     omd.flags &= ~XTR_FLAGS_SAMPLED;
   }
 
-  Napi::Object event = Event::makeFromOboeMetadata(env, omd);
+  Napi::Value event = compact
+    ? Event::makeMetadataBuffer(env, omd)
+    : Napi::Value(Event::makeFromOboeMetadata(env, omd));
   //Napi::Value v = Napi::External<oboe_metadata_t>::New(env, &omd);
   //Napi::Object md = Metadata::NewInstance(env, v);
 
@@ -10,4 +10,19 @@ describe('addon.config', function () {
     expect(version).to.be.a('string')
     expect(version).match(/\d+\.\d+\.\d+/);
   })
+
+  it('should include the send queue in stats', function () {
+    const stats = bindings.Config.getStats();
+    const expected = [
+      'sendQueueRunning',
+      'sendQueueCapacity',
+      'sendQueueDepth',
+      'sendQueueSent',
+      'sendQueueDrops',
+      'sendQueueErrors',
+      'sendQueueLatency',
+      'sendQueueMaxLatency',
+    ];
+    expect(stats).include.all.keys(expected);
+  })
 })
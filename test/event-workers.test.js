@@ -0,0 +1,121 @@
+'use strict';
+//
+// the bindings keep Event state per environment so they can be loaded by
+// worker_threads. this runs traced workloads in several workers at once and
+// checks each worker's own stats and the process-wide aggregate, and moves
+// an event from the main thread to a worker.
+//
+
+const path = require('path');
+const {Worker} = require('worker_threads');
+const aob = require('..');
+const expect = require('chai').expect;
+
+const workerCode = `
+const {parentPort, workerData} = require('worker_threads');
+const aob = require(workerData.bindings);
+
+const status = aob.oboeInit({serviceKey: workerData.serviceKey});
+const parent = aob.Event.makeRandom(1);
+const template = aob.Event.createTemplate({Layer: 'worker', Worker: workerData.id});
+const key = aob.Event.internKey('Index');
+
+for (let i = 0; i < workerData.events; i++) {
+  const event = new aob.Event(parent, true, template);
+  event.addInfo('Label', i & 1 ? 'exit' : 'entry');
+  event.addInfo(key, i);
+  event.sendReport();
+}
+
+parentPort.postMessage({status, stats: aob.Event.getEventStats()});
+`;
+
+const attachCode = `
+const {parentPort, workerData} = require('worker_threads');
+const aob = require(workerData.bindings);
+
+const event = aob.Event.attach(workerData.handle);
+event.addInfo('Label', 'exit');
+parentPort.postMessage({xtrace: event.toString(), status: event.sendReport()});
+`;
+
+function runWorker (id, events) {
+  return new Promise((resolve, reject) => {
+    const worker = new Worker(workerCode, {
+      eval: true,
+      workerData: {
+        bindings: path.resolve(__dirname, '..'),
+        serviceKey: `${process.env.AO_TOKEN_PROD}:node-bindings-test`,
+        id,
+        events,
+      },
+    });
+    let result;
+    worker.on('message', m => result = m);
+    worker.on('error', reject);
+    worker.on('exit', code => code === 0 ? resolve(result) : reject(new Error(`worker exited with ${code}`)));
+  });
+}
+
+describe('addon.event in worker_threads', function () {
+  const serviceKey = `${process.env.AO_TOKEN_PROD}:node-bindings-test`;
+  const workers = 4;
+  const events = 5000;
+
+  before(function () {
+    const status = aob.oboeInit({serviceKey});
+    // -1 is already initialized, 0 is ok.
+    expect(status).oneOf([-1, 0]);
+  });
+
+  it('should keep separate stats in each worker and aggregate them', async function () {
+    this.timeout(60000);
+    const before = aob.Event.getAggregateStats();
+    const mainBefore = aob.Event.getEventStats();
+
+    const results = await Promise.all([...Array(workers).keys()].map(id => runWorker(id, events)));
+
+    for (const r of results) {
+      // the main thread initialized oboe for the process.
+      expect(r.status).oneOf([-1, 0]);
+      // makeRandom() creates one more event.
+      expect(r.stats.totalCreated).equal(events + 1);
+      expect(r.stats.sentCount).equal(events);
+    }
+
+    const after = aob.Event.getAggregateStats();
+    expect(after.totalCreated - before.totalCreated).least(workers * (events + 1));
+    expect(after.sentCount - before.sentCount).least(workers * events);
+    expect(after.bytesUsed).above(before.bytesUsed);
+
+    // the workers' events don't show up in the main thread's stats.
+    const mainAfter = aob.Event.getEventStats();
+    expect(mainAfter.totalCreated).equal(mainBefore.totalCreated);
+  });
+
+  it('should finish and send an event that the main thread began', function (done) {
+    const event = new aob.Event(aob.Event.makeRandom(1));
+    event.addInfo('Layer', 'worker-attach');
+    event.addInfo('Label', 'entry');
+    const xtrace = event.toString();
+    const handle = event.detach();
+
+    const worker = new Worker(attachCode, {
+      eval: true,
+      workerData: {bindings: path.resolve(__dirname, '..'), handle},
+      transferList: [handle],
+    });
+    let result;
+    worker.on('message', m => result = m);
+    worker.on('error', done);
+    worker.on('exit', code => {
+      if (code !== 0) {
+        done(new Error(`worker exited with ${code}`));
+        return;
+      }
+      expect(result.xtrace).equal(xtrace);
+      expect(result.status).least(0);
+      done();
+    });
+  });
+});
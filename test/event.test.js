@@ -96,6 +96,126 @@ describe('addon.event', function () {
     event.addInfo('key', 'val')
   })
 
+  it('should add Buffer and TypedArray values', function () {
+    const event = new aob.Event(aob.Event.makeRandom());
+    expect(event.addInfo('Body', Buffer.from('request body'))).equal(true);
+    expect(event.addInfo('Empty', Buffer.alloc(0))).equal(true);
+    expect(event.addInfo('Words', new Uint16Array([1, 2, 3]))).equal(true);
+    const bytes = new Uint8Array(new ArrayBuffer(64), 16, 8);
+    expect(event.addInfo('Slice', bytes)).equal(true);
+    expect(() => event.addInfo('Bad', Symbol('bad'))).throws(TypeError, 'Value must be');
+  });
+
+  it('should add objects and arrays as subdocuments', function () {
+    const event = new aob.Event(aob.Event.makeRandom());
+    const headers = {host: 'localhost', 'content-length': 42, keepAlive: true};
+    expect(event.addInfo('Headers', headers)).equal(true);
+    expect(event.addInfo('Params', ['a', 1, 2.5, null, undefined, {nested: [[]]}])).equal(true);
+    expect(event.addInfo('Empty', {})).equal(true);
+    expect(event.addInfoBatch({Query: {q: 'x'}, Tags: ['a', 'b']})).equal(0);
+  });
+
+  it('should not add functions as values or object keys', function () {
+    const md = aob.Event.makeRandom(1);
+    const withFunctions = new aob.Event(md);
+    const without = new aob.Event(md);
+    const fn = function () {};
+
+    expect(() => withFunctions.addInfo('Fn', fn)).throws(TypeError, 'Value must be');
+    expect(withFunctions.addInfo('Obj', {a: fn, s: Symbol('s')})).equal(true);
+    expect(without.addInfo('Obj', {})).equal(true);
+
+    // the same bytes are sent, so neither the function nor its key was added.
+    expect(withFunctions.sendReport()).equal(without.sendReport());
+  });
+
+  it('should reject objects that are too deep or too big', function () {
+    const event = new aob.Event(aob.Event.makeRandom());
+    let deep = {};
+    for (let i = 0; i < 20; i++) {
+      deep = {deep};
+    }
+    expect(() => event.addInfo('Deep', deep)).throws(RangeError, 'Object value exceeds the depth or size limit');
+
+    const cycle = {};
+    cycle.self = cycle;
+    expect(() => event.addInfo('Cycle', cycle)).throws(RangeError, 'Object value exceeds the depth or size limit');
+
+    const big = {body: 'x'.repeat(100 * 1024)};
+    expect(() => event.addInfo('Big', big)).throws(RangeError, 'Object value exceeds the depth or size limit');
+
+    // the event should still be usable.
+    expect(event.addInfo('Layer', 'after')).equal(true);
+  });
+
+  it('should add BigInt values', function () {
+    if (Number(process.versions.napi) < 6) {
+      this.skip();
+    }
+    const event = new aob.Event(aob.Event.makeRandom());
+    expect(event.addInfo('Big', 2n ** 62n)).equal(true);
+    expect(event.addInfo('Negative', -(2n ** 63n))).equal(true);
+    expect(() => event.addInfo('TooBig', 2n ** 64n)).throws(RangeError, 'BigInt value must fit in 64 bits');
+    expect(event.addInfoBatch({Big: 1n, TooBig: 2n ** 64n})).equal(1);
+  });
+
+  it('should add multiple KVs from an object using addInfoBatch', function () {
+    const event = new aob.Event(aob.Event.makeRandom());
+    const failures = event.addInfoBatch({Layer: 'test', Label: 'entry', Count: 3, Ratio: 0.5, Ok: true});
+    expect(failures).equal(0);
+  });
+
+  it('should count bad values in addInfoBatch without throwing', function () {
+    const event = new aob.Event(aob.Event.makeRandom());
+    const failures = event.addInfoBatch({good: 'value', bad: Symbol('bad'), alsoBad: undefined, fine: 1});
+    expect(failures).equal(2);
+  });
+
+  it('should add KVs from parallel arrays using addInfos', function () {
+    const event = new aob.Event(aob.Event.makeRandom());
+    expect(event.addInfos(['Layer', 'Label', 'Count'], ['test', 'exit', 42])).equal(0);
+    expect(event.addInfos(['a', 1, 'c'], ['x', 'y', null])).equal(2);
+    expect(() => event.addInfos(['a', 'b'], ['x'])).throws(TypeError, 'keys and values must be the same length');
+    expect(() => event.addInfos({}, [])).throws(TypeError, 'Invalid signature');
+  });
+
+  it('should intern keys and accept handles in place of key strings', function () {
+    const layer = aob.Event.internKey('Layer');
+    const label = aob.Event.internKey('Label');
+    expect(layer).a('number');
+    expect(aob.Event.internKey('Layer')).equal(layer, 'interning again should return the same handle');
+    expect(label).not.equal(layer);
+
+    const event = new aob.Event(aob.Event.makeRandom());
+    expect(event.addInfo(layer, 'test')).equal(true);
+    expect(event.addInfos([label, 'Spec'], ['entry', 'query'])).equal(0);
+    expect(() => event.addInfo(1e9, 'x')).throws(RangeError, 'Invalid key handle');
+    // numbers that would truncate to a handle aren't handles.
+    for (const bad of [layer + 0.5, -1, 2 ** 32 + layer, NaN]) {
+      expect(() => event.addInfo(bad, 'x'), `key ${bad}`).throws(RangeError, 'Invalid key handle');
+    }
+    expect(event.addInfos([layer + 0.5, label], ['x', 'y'])).equal(1);
+    expect(() => aob.Event.internKey(42)).throws(TypeError, 'key must be a string');
+  });
+
+  it('should create templates and apply them to events', function () {
+    const t = aob.Event.createTemplate({Layer: 'pg', Spec: 'query', Flavor: 'postgresql', RemoteHost: 'db:5432'});
+    expect(t).a('number');
+
+    const parent = aob.Event.makeRandom(1);
+    const event = new aob.Event(parent, true, t);
+    expect(event.addInfo('Label', 'entry')).equal(true);
+
+    const other = new aob.Event(parent);
+    expect(other.applyTemplate(t)).equal(true);
+    expect(other.sendReport()).above(0);
+
+    expect(() => new aob.Event(parent, true, 1e9)).throws(RangeError, 'Invalid template');
+    expect(() => other.applyTemplate(1e9)).throws(RangeError, 'Invalid template');
+    expect(() => aob.Event.createTemplate('Layer')).throws(TypeError, 'kvs must be an object');
+    expect(() => aob.Event.createTemplate({Bad: Symbol('bad')})).throws(TypeError, 'Invalid template value for Bad');
+  });
+
   it('shouldn\'t throw when adding an edge from an event', function () {
     const event = new aob.Event(aob.Event.makeRandom());
     const edge = new aob.Event(event);
@@ -137,6 +257,51 @@ describe('addon.event', function () {
     expect(ev1.toString()).equal(evSampled);
   });
 
+  it('Event.makeFromString() should accept either case', function () {
+    const ev = aob.Event.makeFromString(evSampled.toLowerCase());
+    expect(ev.toString()).equal(evSampled);
+  });
+
+  it('Event.makeFromString() should reject invalid strings', function () {
+    const zeroOpId = evSampled.slice(0, 42) + '0'.repeat(16) + evSampled.slice(-2);
+    const tests = [
+      {arg: undefined, text: 'no argument'},
+      {arg: 42, text: 'a number'},
+      {arg: Buffer.from(evSampled, 'hex'), text: 'a buffer'},
+      {arg: '', text: 'an empty string'},
+      {arg: evSampled.slice(0, 58), text: 'a short string'},
+      {arg: evSampled + '00', text: 'a long string'},
+      {arg: 'G' + evSampled.slice(1), text: 'a non-hex character'},
+      {arg: evSampled.slice(0, 59) + '\u0100', text: 'a non-ASCII character'},
+      {arg: evSampled.slice(0, 59) + '\u{1F600}', text: 'a surrogate pair'},
+      {arg: '2A' + evSampled.slice(2), text: 'the wrong header'},
+      {arg: evSampled.slice(0, 58) + '02', text: 'invalid flags'},
+      {arg: zeroOpId, text: 'an all zero op ID'},
+    ];
+
+    for (const t of tests) {
+      expect(aob.Event.makeFromString(t.arg), t.text).equal(undefined);
+    }
+  });
+
+  it('should write an event string into a buffer', function () {
+    const ev = aob.Event.makeFromString(evSampled);
+    const b = Buffer.alloc(80, '.');
+
+    let n = ev.writeTo(b);
+    expect(n).equal(60);
+    expect(b.toString('latin1', 0, n)).equal(ev.toString());
+
+    n = ev.writeTo(b, 10, 1);
+    expect(n).equal(ev.toString(1).length);
+    expect(b.toString('latin1', 10, 10 + n)).equal(ev.toString(1));
+    expect(b[9]).equal('.'.charCodeAt(0), 'should not write before offset');
+
+    expect(() => ev.writeTo('buffer')).throws(TypeError, 'buffer must be a Buffer');
+    expect(() => ev.writeTo(b, 81)).throws(RangeError, 'offset out of range');
+    expect(() => ev.writeTo(b, 30)).throws(RangeError, 'buffer too small');
+  });
+
   it('should serialize an event string', function () {
     const ev1 = aob.Event.makeFromString(evUnsampled);
     const ev2 = new aob.Event(ev1);
@@ -179,10 +344,487 @@ describe('addon.event', function () {
       'totalBytesAllocated',
       'sendtime',
       'averageSendtime',
+      'poolHits',
+      'poolMisses',
+      'poolAvailable',
+      'poolShrunk',
+      'poolExchanged',
+      'disposedCount',
+      'finalizedCount',
+      'lazyEncoding',
+      'lazyCreated',
+      'reallocCount',
+      'presizedCount',
+      'averageWasted',
     ];
+    for (const h of ['lifetime', 'sendtime', 'size']) {
+      expectedStats.push(`${h}P50`, `${h}P90`, `${h}P99`, `${h}Max`);
+    }
     expect(Object.keys(stats)).members(expectedStats);
   });
 
+  it('should report percentiles for the interval since the last call', function () {
+    aob.Event.getEventStats();
+    for (let i = 0; i < 100; i++) {
+      const event = new aob.Event(aob.Event.makeRandom(1));
+      event.addInfo('Layer', 'histograms');
+      event.sendReport();
+    }
+    let stats = aob.Event.getEventStats();
+    expect(stats.sizeP50).above(0);
+    expect(stats.sizeP50).most(stats.sizeP90);
+    expect(stats.sizeP90).most(stats.sizeP99);
+    expect(stats.sizeP99).most(stats.sizeMax);
+    expect(stats.sendtimeMax).least(stats.sendtimeP50);
+
+    // the histograms are reset when read.
+    stats = aob.Event.getEventStats();
+    expect(stats.sizeP50).equal(0);
+    expect(stats.sizeMax).equal(0);
+    expect(stats.sendtimeMax).equal(0);
+  });
+
+  it('should configure the bson buffer pool', function () {
+    const previous = aob.Event.configure();
+    expect(previous).property('poolHighWaterMark').a('number');
+
+    let settings = aob.Event.configure({poolHighWaterMark: 10});
+    expect(settings).property('poolHighWaterMark', 10);
+
+    settings = aob.Event.configure({poolHighWaterMark: previous.poolHighWaterMark});
+    expect(settings).deep.equal(previous);
+
+    expect(() => aob.Event.configure('pool')).throws(TypeError, 'options must be an object');
+  });
+
+  it('should send events from the async send queue', function () {
+    let settings = aob.Event.configure({asyncSend: true, sendQueueSize: 16});
+    expect(settings.asyncSend).equal(true);
+    expect(settings.sendQueueSize).equal(16);
+
+    const event = new aob.Event(aob.Event.makeRandom(1));
+    event.addInfo('Layer', 'async-send-test');
+    event.addInfo('Label', 'single');
+    const bytes = event.sendReport();
+    expect(bytes).above(0, 'should return the number of bytes queued');
+    expect(() => event.addInfo('Too', 'late')).throws(TypeError, 'Invalid signature');
+    expect(event.sendReport()).equal(-2000, 'a sent event cannot be sent again');
+
+    // stopping the queue sends everything queued.
+    settings = aob.Event.configure({asyncSend: false});
+    expect(settings.asyncSend).equal(false);
+
+    const stats = aob.Config.getStats();
+    expect(stats.sendQueueRunning).equal(false);
+    expect(stats.sendQueueDepth).equal(0);
+    expect(stats.sendQueueSent).least(1);
+  });
+
+  it('should send events itself when the async send queue is full', function () {
+    aob.Event.configure({asyncSend: true, sendQueueSize: 2});
+    const before = aob.Event.getEventStats();
+    const events = 200;
+
+    for (let i = 0; i < events; i++) {
+      const event = new aob.Event(aob.Event.makeRandom(1));
+      event.addInfo('Layer', 'async-send-full-test');
+      event.addInfo('Label', 'single');
+      expect(event.sendReport()).above(0, 'every event should be queued or sent');
+      expect(event.sendReport()).below(0, 'an event is sent only once');
+    }
+
+    aob.Event.configure({asyncSend: false});
+    const after = aob.Event.getEventStats();
+    expect(after.sentCount - before.sentCount).equal(events);
+  });
+
+  it('should send events with cached finalization on and off', function () {
+    const previous = aob.Event.configure();
+    expect(previous).property('cachedFinalize', true);
+
+    for (const cachedFinalize of [false, true]) {
+      const settings = aob.Event.configure({cachedFinalize});
+      expect(settings.cachedFinalize).equal(cachedFinalize);
+
+      const event = new aob.Event(aob.Event.makeRandom(1));
+      event.addInfo('Layer', 'cached-finalize-test');
+      event.addInfo('Label', 'single');
+      expect(event.sendReport()).above(0, 'should return the number of bytes sent');
+    }
+
+    aob.Event.configure({cachedFinalize: previous.cachedFinalize});
+  });
+
+  it('should encode the same event with cached finalization on and off', function () {
+    const previous = aob.Event.configure();
+    const md = aob.Event.makeRandom(1);
+    const sizes = {};
+    const xtraces = {};
+
+    // the timestamps differ so compare what can be: the metadata and the
+    // size of the finished document, which includes the timestamp and
+    // hostname elements.
+    for (const cachedFinalize of [false, true]) {
+      aob.Event.configure({cachedFinalize});
+      const event = new aob.Event(md);
+      event.addInfo('Layer', 'cached-finalize-test');
+      event.addInfo('Label', 'entry');
+      xtraces[cachedFinalize] = event.toString(1 | 2 | 8);
+      sizes[cachedFinalize] = event.sendReport();
+    }
+    aob.Event.configure({cachedFinalize: previous.cachedFinalize});
+
+    expect(sizes[true]).above(0);
+    expect(sizes[true]).equal(sizes[false], 'Stamp and oboe should write the same elements');
+    expect(xtraces[true]).equal(xtraces[false]);
+  });
+
+  it('should not send an event twice', function () {
+    const previous = aob.Event.configure();
+
+    for (const cachedFinalize of [false, true]) {
+      aob.Event.configure({cachedFinalize, asyncSend: false});
+      const event = new aob.Event(aob.Event.makeRandom(1));
+      event.addInfo('Layer', 'send-twice-test');
+      event.addInfo('Label', 'single');
+      expect(event.sendReport()).above(0, 'should return the number of bytes sent');
+      expect(event.sendReport()).equal(-1000, 'a finished event cannot be sent again');
+    }
+
+    aob.Event.configure({cachedFinalize: previous.cachedFinalize});
+  });
+
+  it('should make unique random IDs with pooled IDs on and off', function () {
+    const previous = aob.Event.configure();
+    expect(previous).property('pooledIds', true);
+
+    for (const pooledIds of [false, true]) {
+      const settings = aob.Event.configure({pooledIds});
+      expect(settings.pooledIds).equal(pooledIds);
+
+      const parent = aob.Event.makeRandom(1);
+      const ids = new Set();
+      for (let i = 0; i < 1000; i++) {
+        const md = aob.Event.makeRandom(1).toString(aob.Event.fmtHuman);
+        const event = new aob.Event(parent);
+        const [, task, op] = event.toString(aob.Event.fmtHuman).split('-');
+        expect(task).equal(parent.toString(aob.Event.fmtHuman).split('-')[1]);
+        expect(op).not.match(/^0+$/);
+        ids.add(md.split('-')[1]);
+        ids.add(op);
+      }
+      expect(ids.size).equal(2000, 'task and op IDs should not repeat');
+    }
+
+    aob.Event.configure({pooledIds: previous.pooledIds});
+  });
+
+  it('should release an event\'s buffer with dispose()', function () {
+    const before = aob.Event.getEventStats();
+    const event = new aob.Event(aob.Event.makeRandom(1));
+    event.addInfo('Layer', 'dispose-test');
+    const xtrace = event.toString();
+
+    expect(event.dispose()).equal(true);
+    expect(event.getBytesAllocated()).equal(224, 'only the event should remain');
+    expect(event.dispose()).equal(false, 'an event can only be disposed once');
+    expect(() => event.addInfo('Too', 'late')).throws(TypeError, 'Invalid signature');
+    expect(event.sendReport()).equal(-2000, 'a disposed event cannot be sent');
+    expect(event.toString()).equal(xtrace, 'the metadata should still be valid');
+
+    expect(aob.Event.makeRandom().dispose()).equal(false, 'a metadata-only event has no buffer');
+
+    const after = aob.Event.getEventStats();
+    expect(after.disposedCount - before.disposedCount).equal(1);
+  });
+
+  it('should make metadata buffers without an Event', function () {
+    const sampled = aob.Event.randomMetadata(1);
+    expect(sampled).instanceof(Buffer);
+    expect(sampled.length).equal(30);
+    expect(sampled[0]).equal(0x2b);
+    expect(sampled[29]).equal(1);
+    expect(aob.Event.randomMetadata()[29]).equal(0);
+
+    const md = aob.Event.metadataFromString(evSampled);
+    expect(md.toString('hex').toUpperCase()).equal(evSampled);
+    expect(aob.Event.metadataFromString(evSampled.toLowerCase()).equals(md)).equal(true);
+    expect(aob.Event.metadataFromString('2B' + '0'.repeat(58))).equal(undefined);
+    expect(aob.Event.metadataFromString(evSampled.slice(2))).equal(undefined);
+  });
+
+  it('should accept metadata buffers in new Event() and addEdge()', function () {
+    const md = aob.Event.randomMetadata(1);
+    const task = md.toString('hex', 1, 21).toUpperCase();
+
+    const event = new aob.Event(md, true);
+    expect(event.toString().slice(2, 42)).equal(task);
+    expect(event.getSampleFlag()).equal(true);
+
+    const other = new aob.Event(aob.Event.makeRandom(1));
+    expect(other.addEdge(aob.Event.randomMetadata(1))).equal(true);
+    expect(() => other.addEdge(Buffer.alloc(30))).throws(TypeError, 'invalid edge');
+
+    expect(() => new aob.Event(Buffer.alloc(30))).throws(TypeError, 'invalid metadata');
+    expect(() => new aob.Event(md.subarray(1))).throws(TypeError, 'invalid metadata');
+  });
+
+  it('should move an event with detach() and attach()', function () {
+    const event = new aob.Event(aob.Event.makeRandom(1));
+    event.addInfo('Layer', 'detach-test');
+    const xtrace = event.toString();
+    const bytes = event.getBytesAllocated();
+
+    const handle = event.detach();
+    expect(handle).instanceof(ArrayBuffer);
+    expect(event.getBytesAllocated()).equal(224, 'the buffer should move with the handle');
+    expect(event.detach()).equal(undefined, 'an event can only be detached once');
+    expect(() => event.addInfo('Too', 'late')).throws(TypeError, 'Invalid signature');
+    expect(event.toString()).equal(xtrace, 'the metadata should still be valid');
+
+    const attached = aob.Event.attach(handle);
+    expect(attached).instanceof(aob.Event);
+    expect(attached.toString()).equal(xtrace);
+    expect(attached.getBytesAllocated()).equal(bytes);
+    attached.addInfo('Label', 'entry');
+    expect(attached.sendReport()).least(0);
+
+    expect(aob.Event.attach(handle)).equal(undefined, 'a handle can only be attached once');
+    expect(aob.Event.attach(new ArrayBuffer(16))).equal(undefined);
+
+    // a handle with the right sequence number but the wrong token is rejected.
+    const other = new aob.Event(aob.Event.makeRandom(1));
+    const real = other.detach();
+    const forged = real.slice(0);
+    const view = new Uint8Array(forged);
+    view[view.length - 1] ^= 0xff;
+    expect(aob.Event.attach(forged)).equal(undefined, 'a forged handle should be rejected');
+    expect(aob.Event.attach(real)).instanceof(aob.Event);
+
+    expect(() => aob.Event.attach({})).throws(TypeError, 'handle must be an ArrayBuffer');
+    expect(aob.Event.makeRandom().detach()).equal(undefined, 'a metadata-only event has no buffer');
+  });
+
+  it('should not attach a handle that has expired', function (done) {
+    const previous = aob.Event.configure();
+    expect(previous).property('detachedLifetime', 60000);
+    aob.Event.configure({detachedLifetime: 1});
+
+    const event = new aob.Event(aob.Event.makeRandom(1));
+    const handle = event.detach();
+    expect(handle).instanceof(ArrayBuffer);
+
+    setTimeout(function () {
+      const attached = aob.Event.attach(handle);
+      aob.Event.configure({detachedLifetime: previous.detachedLifetime});
+      expect(attached).equal(undefined, 'an expired handle should be rejected');
+      done();
+    }, 20);
+  });
+
+  it('should dispose events after sending when autoDispose is set', function () {
+    const settings = aob.Event.configure({autoDispose: true});
+    expect(settings.autoDispose).equal(true);
+
+    const event = new aob.Event(aob.Event.makeRandom(1));
+    event.addInfo('Layer', 'auto-dispose-test');
+    event.addInfo('Label', 'single');
+    event.sendReport();
+    expect(event.getBytesAllocated()).equal(224, 'the buffer should be released');
+    expect(event.dispose()).equal(false, 'it was already disposed');
+
+    aob.Event.configure({autoDispose: false});
+  });
+
+  it('should defer encoding KVs when lazyEncoding is set', function () {
+    const value = 'x'.repeat(500);
+    function sendBig () {
+      const event = new aob.Event(aob.Event.makeRandom(1));
+      for (let i = 0; i < 10; i++) {
+        event.addInfo(`Key${i}`, value);
+      }
+      event.addInfo('Headers', {host: 'localhost'});
+      event.addInfos(['Count', 'Ok', 'Body'], [42, true, Buffer.from('body')]);
+      return event.sendReport();
+    }
+
+    let before = aob.Event.getEventStats();
+    expect(sendBig()).above(5000);
+    let after = aob.Event.getEventStats();
+    const eagerReallocs = after.reallocCount - before.reallocCount;
+
+    const settings = aob.Event.configure({lazyEncoding: true});
+    expect(settings.lazyEncoding).equal(true);
+
+    before = aob.Event.getEventStats();
+    expect(sendBig()).above(5000);
+    after = aob.Event.getEventStats();
+    expect(after.lazyEncoding).equal(true);
+    expect(after.lazyCreated - before.lazyCreated).equal(1);
+    const lazyReallocs = after.reallocCount - before.reallocCount;
+    expect(lazyReallocs).most(1, 'the buffer should grow at most once');
+    expect(lazyReallocs).most(eagerReallocs);
+
+    aob.Event.configure({lazyEncoding: false});
+  });
+
+  it('should presize buffers from the sizes of earlier events', function () {
+    const value = 'x'.repeat(500);
+    function send () {
+      const event = new aob.Event(aob.Event.makeRandom(1));
+      event.addInfo('Layer', 'presize-test');
+      for (let i = 0; i < 10; i++) {
+        event.addInfo(`Key${i}`, value);
+      }
+      return event.sendReport();
+    }
+
+    // learn the size.
+    for (let i = 0; i < 8; i++) {
+      expect(send()).above(5000);
+    }
+
+    const before = aob.Event.getEventStats();
+    expect(send()).above(5000);
+    const after = aob.Event.getEventStats();
+    expect(after.presizedCount - before.presizedCount).equal(1);
+    expect(after.reallocCount - before.reallocCount).most(1, 'the buffer should only grow when presized');
+    expect(after.averageWasted).a('number');
+  });
+
+  it('should presize from the pool without reallocating', function () {
+    const value = 'x'.repeat(500);
+    function send () {
+      const event = new aob.Event(aob.Event.makeRandom(1));
+      event.addInfo('Layer', 'presize-pool-test');
+      for (let i = 0; i < 10; i++) {
+        event.addInfo(`Key${i}`, value);
+      }
+      const bytes = event.sendReport();
+      // give the buffer back to the pool now rather than at gc.
+      event.dispose();
+      return bytes;
+    }
+
+    // learn the size, then presize once so the pool holds a buffer of the
+    // predicted class.
+    for (let i = 0; i < 9; i++) {
+      expect(send()).above(5000);
+    }
+
+    const before = aob.Event.getEventStats();
+    expect(send()).above(5000);
+    const after = aob.Event.getEventStats();
+    expect(after.presizedCount - before.presizedCount).equal(1);
+    expect(after.poolExchanged - before.poolExchanged).equal(1);
+    expect(after.reallocCount - before.reallocCount).equal(0, 'a second presized event should not realloc');
+  });
+
+  it('should send a batch of events and return their statuses', function () {
+    const parent = aob.Event.makeRandom(1);
+    const events = [];
+    for (let i = 0; i < 3; i++) {
+      const event = new aob.Event(parent, i > 0);
+      event.addInfo('Layer', 'batch-test');
+      event.addInfo('Label', 'exit');
+      events.push(event);
+    }
+    events.push(aob.Event.makeRandom());
+
+    const statuses = aob.Event.sendBatch(events, aob.Event.SEND_EVENT);
+    expect(statuses).instanceof(Int32Array);
+    expect(statuses.length).equal(events.length);
+    for (let i = 0; i < 3; i++) {
+      expect(statuses[i]).above(0, 'should return the number of bytes sent');
+    }
+    expect(statuses[3]).equal(-2000, 'a metadata-only event cannot be sent');
+
+    expect(() => aob.Event.sendBatch('events')).throws(TypeError, 'events must be an array');
+    expect(() => aob.Event.sendBatch([], 99)).throws(RangeError, 'invalid channel');
+  });
+
+  it('should send a batch with cached finalization off', function () {
+    const previous = aob.Event.configure();
+    aob.Event.configure({cachedFinalize: false});
+
+    const parent = aob.Event.makeRandom(1);
+    const events = [];
+    for (let i = 0; i < 3; i++) {
+      const event = new aob.Event(parent);
+      event.addInfo('Layer', 'batch-test');
+      events.push(event);
+    }
+    const statuses = aob.Event.sendBatch(events);
+    aob.Event.configure({cachedFinalize: previous.cachedFinalize});
+
+    for (let i = 0; i < 3; i++) {
+      expect(statuses[i]).above(0, 'should return the number of bytes sent');
+    }
+  });
+
+  it('should fail only the disposed and sent events in a batch', function () {
+    const parent = aob.Event.makeRandom(1);
+    const make = () => {
+      const event = new aob.Event(parent);
+      event.addInfo('Layer', 'batch-test');
+      return event;
+    };
+    const disposed = make();
+    expect(disposed.dispose()).equal(true);
+    const sent = make();
+    expect(sent.sendReport()).above(0);
+
+    const events = [make(), disposed, make(), sent, make()];
+    const statuses = aob.Event.sendBatch(events);
+    expect(statuses[0]).above(0);
+    expect(statuses[1]).below(0, 'a disposed event cannot be sent');
+    expect(statuses[2]).above(0);
+    expect(statuses[3]).below(0, 'an event cannot be sent twice');
+    expect(statuses[4]).above(0);
+  });
+
+  it('should count pool hits and misses for full events', function () {
+    const before = aob.Event.getEventStats();
+    const event = new aob.Event(aob.Event.makeRandom());
+    const after = aob.Event.getEventStats();
+    const used = (after.poolHits - before.poolHits) + (after.poolMisses - before.poolMisses);
+    expect(used).equal(1, 'a full event should be a pool hit or miss');
+    expect(event.getBytesAllocated()).equal(224 + 1024);
+  });
+
+  it('should reuse the buffer of a disposed event', function () {
+    // the pool learns oboe's buffer layout from the first events it sees.
+    new aob.Event(aob.Event.makeRandom());
+    new aob.Event(aob.Event.makeRandom());
+
+    const first = new aob.Event(aob.Event.makeRandom());
+    expect(first.dispose()).equal(true);
+    const before = aob.Event.getEventStats();
+    const second = new aob.Event(aob.Event.makeRandom());
+    const after = aob.Event.getEventStats();
+    expect(after.poolHits).equal(before.poolHits + 1);
+    expect(after.poolAvailable).equal(before.poolAvailable - 1);
+    expect(second.getBytesAllocated()).equal(224 + 1024);
+  });
+
+  it('should pool a grown buffer in its size class', function () {
+    const event = new aob.Event(aob.Event.makeRandom());
+    expect(event.addInfo('Big', 'x'.repeat(4096))).equal(true);
+    expect(event.getBytesAllocated()).above(224 + 4096);
+
+    const before = aob.Event.getEventStats();
+    expect(event.dispose()).equal(true);
+    const after = aob.Event.getEventStats();
+    // it's shrunk only if oboe didn't grow it to a class size.
+    expect(after.poolShrunk - before.poolShrunk).most(1);
+    expect(after.poolAvailable).equal(before.poolAvailable + 1);
+
+    // new events still get a buffer of the size oboe allocates.
+
+    const reused = new aob.Event(aob.Event.makeRandom());
+    expect(reused.getBytesAllocated()).equal(224 + 1024);
+  });
+
   it('makeRandom() should allocate a small event', function () {
     const event = new aob.Event.makeRandom();
     const bytes = event.getBytesAllocated();
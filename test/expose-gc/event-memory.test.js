@@ -0,0 +1,62 @@
+'use strict';
+//
+// events hold bson buffers that V8 can't see unless the bindings report
+// them as external memory. this creates bursts of events without calling
+// gc() so collection is driven only by the memory V8 knows about. if the
+// buffers are reported, RSS levels off after the first bursts; if not, the
+// heap looks small and RSS keeps growing until a collection happens for
+// some other reason.
+//
+
+const aob = require('../..');
+const expect = require('chai').expect;
+
+describe('event-memory', function () {
+  const serviceKey = `${process.env.AO_TOKEN_PROD}:node-bindings-test`;
+
+  before(function () {
+    const status = aob.oboeInit({serviceKey});
+    // -1 is already initialized, 0 is ok.
+    expect(status).oneOf([-1, 0]);
+  });
+
+  it('should plateau RSS when creating bursts of events', function () {
+    this.timeout(120000);
+    const burst = 100000;
+    const warmupBursts = 10;
+    const checkBursts = 40;
+    // a single burst holds about 125MB of bson buffers if none are collected.
+    const tolerance = (process.env.CI ? 64 : 32) * 1024 * 1024;
+
+    // garbage collect if available
+    const gc = typeof global.gc === 'function' ? global.gc : () => null;
+
+    const parent = aob.Event.makeRandom(1);
+    const value = 'x'.repeat(200);
+
+    function makeBurst () {
+      for (let i = 0; i < burst; i++) {
+        const event = new aob.Event(parent);
+        event.addInfo('Layer', 'event-memory');
+        event.addInfo('Label', 'entry');
+        event.addInfo('Value', value);
+      }
+    }
+
+    // let the heap and the buffer pool reach a steady state.
+    for (let i = 0; i < warmupBursts; i++) {
+      makeBurst();
+    }
+    gc();
+
+    const start = process.memoryUsage().rss;
+    let peak = start;
+    for (let i = 0; i < checkBursts; i++) {
+      makeBurst();
+      peak = Math.max(peak, process.memoryUsage().rss);
+    }
+
+    const growth = peak - start;
+    expect(growth).below(tolerance, `RSS grew ${growth} bytes over ${checkBursts} bursts`);
+  });
+});
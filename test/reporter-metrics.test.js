@@ -107,4 +107,242 @@ describe('reporter-metrics', function () {
       expect(metric).deep.equal(expected);
     }
   });
+
+  it('should aggregate metrics by name, tags and host tag', function () {
+    // start with an empty aggregator.
+    aob.Reporter.flushAggregator({noop: true});
+
+    const metrics = [
+      {name: 'testing.node.agg', tags: {a: '1', b: '2'}},
+      {name: 'testing.node.agg', count: 2, tags: {b: '2', a: '1'}},
+      {name: 'testing.node.agg', tags: {a: '1', b: '2'}, addHostTag: true},
+      {name: 'testing.node.agg.value', value: 20},
+      {name: 'testing.node.agg.value', value: 10},
+      {name: 'testing.node.agg.value', value: 30},
+    ];
+    const results = aob.Reporter.sendMetrics(metrics, {aggregate: true});
+    expect(results).deep.equal({errors: []});
+    expect(aob.Reporter.configureAggregator()).property('running', true);
+
+    const flushed = aob.Reporter.flushAggregator({testing: true, noop: true});
+    expect(flushed.sent).equal(3);
+    expect(flushed.errors).equal(0);
+
+    const find = (name, addHostTag) => flushed.series.find(s => s.name === name && s.addHostTag === addHostTag);
+    expect(find('testing.node.agg', false)).deep.equal({
+      name: 'testing.node.agg', count: 3, addHostTag: false, tags: {a: '1', b: '2'}
+    });
+    expect(find('testing.node.agg', true)).deep.equal({
+      name: 'testing.node.agg', count: 1, addHostTag: true, tags: {a: '1', b: '2'}
+    });
+    expect(find('testing.node.agg.value', false)).deep.equal({
+      name: 'testing.node.agg.value', count: 3, value: 60, min: 10, max: 30, addHostTag: false
+    });
+
+    // everything was sent so there's nothing left.
+    expect(aob.Reporter.flushAggregator({testing: true, noop: true}).series).deep.equal([]);
+  });
+
+  it('should send aggregate metrics directly when the interval is 0', function () {
+    aob.Reporter.configureAggregator({interval: 0});
+    const results = aob.Reporter.sendMetrics([{name: 'testing.node.agg'}], {aggregate: true, noop: true});
+    expect(results).deep.equal({errors: []});
+    expect(aob.Reporter.configureAggregator()).deep.equal({interval: 0, running: false});
+    expect(aob.Reporter.flushAggregator({testing: true, noop: true}).series).deep.equal([]);
+
+    const settings = aob.Reporter.configureAggregator({interval: 60000});
+    expect(settings).deep.equal({interval: 60000, running: false});
+  });
+
+  it('should send registered counters and summaries', function () {
+    aob.Reporter.flushAggregator({noop: true});
+
+    const counter = aob.Reporter.registerCounter('testing.node.handle.count', {route: '/x'});
+    expect(counter).instanceof(Int32Array);
+    expect(counter.buffer).instanceof(SharedArrayBuffer);
+    expect(counter.length).equal(1);
+    // the same metric gets the same storage.
+    expect(aob.Reporter.registerCounter('testing.node.handle.count', {route: '/x'})).equal(counter);
+
+    const summary = aob.Reporter.registerSummary('testing.node.handle.value', {}, {addHostTag: true});
+    expect(summary).instanceof(Float64Array);
+    expect(summary.length).equal(2);
+
+    Atomics.add(counter, 0, 2);
+    counter[0] += 1;
+    summary[0] += 2;
+    summary[1] += 7.5;
+
+    const {series} = aob.Reporter.flushAggregator({testing: true, noop: true});
+    const c = series.find(s => s.name === 'testing.node.handle.count');
+    expect(c).deep.equal({name: 'testing.node.handle.count', count: 3, addHostTag: false, tags: {route: '/x'}});
+    const v = series.find(s => s.name === 'testing.node.handle.value');
+    expect(v).include({count: 2, value: 7.5, addHostTag: true});
+
+    // the slots were reset and nothing is sent for them until they change.
+    expect(counter[0]).equal(0);
+    expect(Array.from(summary)).deep.equal([0, 0]);
+    expect(aob.Reporter.flushAggregator({testing: true, noop: true}).series).deep.equal([]);
+  });
+
+  it('should drain registered handles at the new interval', function (done) {
+    const previous = aob.Reporter.configureAggregator();
+    const counter = aob.Reporter.registerCounter('testing.node.handle.interval');
+    aob.Reporter.configureAggregator({interval: 20});
+    counter[0] += 1;
+
+    setTimeout(function () {
+      aob.Reporter.configureAggregator({interval: previous.interval});
+      expect(counter[0]).equal(0, 'the timer should have drained the counter');
+      done();
+    }, 200);
+  });
+
+  it('should validate registerCounter() arguments', function () {
+    expect(() => aob.Reporter.registerCounter()).throws('name must be a string');
+    expect(() => aob.Reporter.registerCounter('x', ['y'])).throws('tags must be a plain object');
+  });
+
+  it('should send histogram percentiles, min and max', function () {
+    aob.Reporter.flushAggregator({noop: true});
+
+    const h = aob.Reporter.createHistogram('testing.node.histogram', {route: '/x'}, {percentiles: [50, 99.9]});
+    expect(h).instanceof(aob.Reporter.Histogram);
+    for (let i = 1; i <= 1000; i++) {
+      h.record(i);
+    }
+
+    const {series} = aob.Reporter.flushAggregator({testing: true, noop: true});
+    const sent = {};
+    for (const s of series.filter(s => s.name.startsWith('testing.node.histogram.'))) {
+      expect(s).include({count: 1, addHostTag: false});
+      expect(s.tags).deep.equal({route: '/x'});
+      sent[s.name.slice('testing.node.histogram.'.length)] = s.value;
+    }
+    expect(sent).keys('p50', 'p99.9', 'min', 'max');
+    // two significant figures by default.
+    expect(sent.p50).within(495, 505);
+    expect(sent['p99.9']).within(990, 1010);
+    expect(sent.min).equal(1);
+    expect(sent.max).within(995, 1010);
+
+    // nothing is sent when nothing was recorded.
+    expect(aob.Reporter.flushAggregator({testing: true, noop: true}).series).deep.equal([]);
+  });
+
+  it('should validate histogram options', function () {
+    const create = (...args) => () => aob.Reporter.createHistogram(...args);
+    expect(create()).throws('name must be a string');
+    expect(create('x', 'y')).throws('tags must be a plain object');
+    expect(create('x', {}, {precision: 6})).throws('precision must be 1 to 5');
+    expect(create('x', {}, {max: 1})).throws('max must be at least 2');
+    expect(create('x', {}, {percentiles: [0]})).throws('percentiles must be greater than 0 and at most 100');
+  });
+
+  it('should intern tag sets', function () {
+    const id = aob.Reporter.internTags({route: '/x', method: 'GET'});
+    expect(id).a('number');
+    expect(aob.Reporter.internTags({method: 'GET', route: '/x'})).equal(id);
+    expect(aob.Reporter.internTags({route: '/y', method: 'GET'})).not.equal(id);
+    expect(aob.Reporter.internTags({})).equal(0);
+    expect(() => aob.Reporter.internTags('route')).throws('tags must be a plain object');
+  });
+
+  it('should send metrics with interned tags', function () {
+    const id = aob.Reporter.internTags({route: '/x', method: 'GET'});
+    const metrics = [
+      {name: 'testing.node.interned', tags: id},
+      {name: 'testing.node.interned', value: 4, tags: id, addHostTag: true},
+      {name: 'testing.node.interned', tags: 0},
+    ];
+    const results = aob.Reporter.sendMetrics(metrics, {testing: true, noop: true});
+    expect(results.errors).deep.equal([]);
+    expect(results.correct).deep.equal([
+      {name: 'testing.node.interned', count: 1, addHostTag: false, tags: {method: 'GET', route: '/x'}},
+      {name: 'testing.node.interned', count: 1, value: 4, addHostTag: true, tags: {method: 'GET', route: '/x'}},
+      {name: 'testing.node.interned', count: 1, addHostTag: false},
+    ]);
+
+    const bad = [{name: 'testing.node.interned', tags: 1e9}, {name: 'testing.node.interned', tags: 1.5}];
+    const errors = aob.Reporter.sendMetrics(bad, {noop: true}).errors;
+    expect(errors.map(e => e.code)).deep.equal(['tags id not found', 'tags id not found']);
+  });
+
+  it('should aggregate interned and object tags as one series', function () {
+    aob.Reporter.flushAggregator({noop: true});
+    const id = aob.Reporter.internTags({route: '/x', method: 'GET'});
+    aob.Reporter.sendMetrics([
+      {name: 'testing.node.interned.agg', tags: id},
+      {name: 'testing.node.interned.agg', tags: {method: 'GET', route: '/x'}},
+    ], {aggregate: true});
+    const {series} = aob.Reporter.flushAggregator({testing: true, noop: true});
+    expect(series).deep.equal([
+      {name: 'testing.node.interned.agg', count: 2, addHostTag: false, tags: {method: 'GET', route: '/x'}},
+    ]);
+  });
+
+  it('should intern metric names', function () {
+    const id = aob.Reporter.internName('testing.node.columnar');
+    expect(id).a('number');
+    expect(aob.Reporter.internName('testing.node.columnar')).equal(id);
+    expect(aob.Reporter.internName('testing.node.columnar.other')).not.equal(id);
+    expect(() => aob.Reporter.internName(42)).throws('name must be a string');
+  });
+
+  it('should send columnar metrics and return failing indexes', function () {
+    const {internName, internTags, COLUMNAR_SUMMARY, COLUMNAR_HOST_TAG} = aob.Reporter;
+    const name = internName('testing.node.columnar');
+    const tags = internTags({route: '/x'});
+
+    const columns = {
+      nameIds: Uint32Array.of(name, name, 1e9, name, name),
+      counts: Float64Array.of(1, 2, 1, 0, 3),
+      values: Float64Array.of(0, 10, 0, 0, 0),
+      tagIds: Uint32Array.of(tags, 0, tags, tags, 1e9),
+      flags: Uint8Array.of(0, COLUMNAR_SUMMARY | COLUMNAR_HOST_TAG, 0, 0, 0),
+    };
+    const failed = aob.Reporter.sendMetricsColumnar(columns, {noop: true});
+    expect(failed).instanceof(Uint32Array);
+    // unknown name, count of 0 and unknown tags.
+    expect(Array.from(failed)).deep.equal([2, 3, 4]);
+
+    // only nameIds is required.
+    const none = aob.Reporter.sendMetricsColumnar({nameIds: Uint32Array.of(name)}, {noop: true});
+    expect(none.length).equal(0);
+  });
+
+  it('should fail columnar rows whose count is not an int', function () {
+    const name = aob.Reporter.internName('testing.node.columnar');
+    const counts = Float64Array.of(1, 2147483647, 2147483648, 1e20, 1.5, -1, NaN, Infinity);
+    const nameIds = new Uint32Array(counts.length).fill(name);
+    const failed = aob.Reporter.sendMetricsColumnar({nameIds, counts}, {noop: true});
+    expect(Array.from(failed)).deep.equal([2, 3, 4, 5, 6, 7]);
+  });
+
+  it('should aggregate columnar metrics', function () {
+    aob.Reporter.flushAggregator({noop: true});
+    const name = aob.Reporter.internName('testing.node.columnar.agg');
+    const tags = aob.Reporter.internTags({route: '/x'});
+    const columns = {
+      nameIds: Uint32Array.of(name, name),
+      values: Float64Array.of(5, 7),
+      tagIds: Uint32Array.of(tags, tags),
+      flags: Uint8Array.of(aob.Reporter.COLUMNAR_SUMMARY, aob.Reporter.COLUMNAR_SUMMARY),
+    };
+    expect(aob.Reporter.sendMetricsColumnar(columns, {aggregate: true}).length).equal(0);
+
+    const {series} = aob.Reporter.flushAggregator({testing: true, noop: true});
+    expect(series).deep.equal([{
+      name: 'testing.node.columnar.agg', count: 2, value: 12, min: 5, max: 7, addHostTag: false, tags: {route: '/x'}
+    }]);
+  });
+
+  it('should validate sendMetricsColumnar() columns', function () {
+    const nameIds = Uint32Array.of(0, 0);
+    const send = columns => () => aob.Reporter.sendMetricsColumnar(columns, {noop: true});
+    expect(send()).throws('invalid signature for sendMetricsColumnar()');
+    expect(send({nameIds: [0, 0]})).throws('columns must be typed arrays');
+    expect(send({nameIds, counts: Uint32Array.of(1, 1)})).throws('columns must be typed arrays');
+    expect(send({nameIds, counts: Float64Array.of(1)})).throws('columns must be typed arrays');
+  });
 })
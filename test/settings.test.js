@@ -92,6 +92,17 @@ describe('addon.settings', function () {
     expect(settings.metadata.toString()).equal(xtrace);
   })
 
+  it('should accept and return metadata as a buffer', function () {
+    const md = bindings.Event.randomMetadata(0);
+    const xtrace = md.toString('hex').toUpperCase();
+    const settings = bindings.Settings.getTraceSettings({xtrace: md, compact: true});
+
+    expect(settings).property('status', -1)       // -1 means non-sampled xtrace
+    expect(settings).property('metadataFromXtrace', true);
+    expect(settings.metadata).instanceof(Buffer);
+    expect(settings.metadata.toString('hex').toUpperCase()).equal(xtrace);
+  })
+
   it('should get verification that a request should be sampled', function (done) {
     bindings.Settings.setTracingMode(bindings.TRACE_ALWAYS)
     bindings.Settings.setDefaultSampleRate(bindings.MAX_SAMPLE_RATE)